@@ -1,4 +1,4 @@
-/*  
+/*
 *   Dylan Baker
 *   C0484294
 *   COMP-166-001
@@ -11,12 +11,72 @@
 *                Time (s)    Height (m)    Velocity (m/s)
 *                  0.000          2.00        0.00
 *                  0.100          1.95        0.98
-*                  0.200          1.81        1.93    
+*                  0.200          1.81        1.93
 *
 *                    Ctrl-C exits program loop
+*
+*           Run with --batch to drop many objects at once. Each line of
+*           the scenario file holds an initial height (m), a mass (kg)
+*           and a time interval (s); "-" reads the scenarios from
+*           standard input. Every scenario is stepped exactly as the
+*           interactive loop steps it, and one summary line is printed
+*           per scenario:
+*
+*                Scenario    Impact time (s)    Impact velocity (m/s)    Steps
+*                       1           0.600000                 5.875287        6
+*
+*           --method rk45 steps each scenario with an adaptive
+*           Dormand-Prince 5(4) integrator instead of the fixed interval,
+*           keeping the local error within --tolerance, and finds the
+*           moment of impact within the last step by root finding. The
+*           time interval of the scenario is then only the first step
+*           tried. --bench HEIGHT compares the steps, time and error of
+*           both integrators for one drop.
+*
+*           --query FILE answers questions without stepping at all. Each
+*           line asks "impact HEIGHT MASS" for the time and velocity of
+*           impact, or "height HEIGHT MASS TIME" for the height and
+*           velocity at a time. With constant air density these come
+*           from the closed-form solution of a fall from rest against
+*           quadratic drag. --scale-height makes the density thin out
+*           with altitude; impact questions are then integrated, or,
+*           for a mass asked about as many times as a table has points,
+*           interpolated from a table of drops built for that mass.
+*
+*           --monte-carlo N drops N objects from --height, drawing the
+*           mass, drag coefficient and air density of each from the
+*           distributions given with --mass-dist, --drag-dist and
+*           --density-dist, and reports the mean, deviation and
+*           percentiles of the impact time and velocity. Every sample
+*           draws from its own counter of a Philox generator, so the
+*           report depends on --seed but not on --threads.
+*
+*           --trajectory FILE writes the trajectory of one drop from
+*           --height, stepped like the interactive loop at --interval
+*           until it lands, in the table format above, as CSV, or as
+*           binary records of three doubles (time, height, velocity).
+*           --every N and --every-time DT keep only every Nth step or
+*           one step per DT seconds.
+*
+*           Build with: gcc -O2 -ffp-contract=off -pthread -o AccelModel AccelModel.c -lm
+*           (-ffp-contract=off keeps the compiler from fusing multiplies
+*           and adds, so that every kernel rounds exactly like the loop)
 */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
 
 #define DENSITY 1.204         // Air density in kg/m^3
 #define GRAVITY 9.806         // Gravitational accel. in m/s^2
@@ -24,8 +84,332 @@
 #define DRAG 0.5              // Drag coefficient
 #define MAX_ITERATIONS 2000   // Max # of iterations program is allowed to run
 #define HALF 0.5              // For division by two
+#define SWEEP_TILE 16         // Scenarios stepped together by a sweep kernel
+#define SWEEP_CHUNK 1024      // Scenarios claimed at a time by a sweep thread
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define DEFAULT_TOLERANCE 1e-6      // Local error allowed per adaptive step
+#define ADAPTIVE_MAX_STEPS 1000000  // Steps an adaptive drop may take before it is given up
+#define ROOT_ITERATIONS 100         // Most iterations used to find the moment of impact
+#define BENCH_MASS 7.0              // Mass of a single drop unless --mass is given
+#define BENCH_SECONDS 0.2           // Least time spent timing each benchmark setting
+#define TABLE_POINTS 2048           // Default intervals of an impact table
+#define TABLE_HEIGHT 20000.0        // Default highest drop covered by an impact table (m)
+#define TABLE_TOLERANCE 1e-11       // Tolerance of the drops that fill an impact table
+#define TABLE_CACHE 16              // Impact tables kept at once, one per mass
+#define MASS_COUNTER_BITS 10        // Masses whose questions are counted toward a table, as a power of two
+#define MASS_COUNTERS (1 << MASS_COUNTER_BITS)
+#define MONTE_CARLO_CHUNK 16384     // Samples claimed at a time by a Monte Carlo thread
+#define DIST_FIXED 0                // Kinds of parameter distribution
+#define DIST_UNIFORM 1
+#define DIST_NORMAL 2
+#define DIST_LOGNORMAL 3
+#define TRAJECTORY_BUFFER_SIZE (1 << 20)    // Bytes of trajectory gathered before each write
+#define TRAJECTORY_FIELD 352        // Room for one number formatted by formatFixed, even 1e308
+#define TRAJECTORY_ROW (3 * TRAJECTORY_FIELD + 16)  // Room for one formatted trajectory row
+#define FAST_FORMAT_LIMIT 1e9       // Largest scaled value that formatFixed converts itself
+#define FAST_FORMAT_MARGIN 1e-6     // Distance from a rounding tie below which snprintf decides
+#define FORMAT_TABLE 0              // Formats of a written trajectory
+#define FORMAT_CSV 1
+#define FORMAT_BINARY 2
+
+// Drag force per squared velocity, grouped as the loop groups it
+#define DRAG_FACTOR (CROSSAREA * DENSITY * DRAG)
+
+/**
+ * @brief Scenarios of a batch run and their results, one array per field.
+ */
+typedef struct {
+    long count;                 // Number of scenarios
+    long capacity;              // Room in each array
+    double *height;             // Initial height (m)
+    double *mass;               // Mass (kg)
+    double *interval;           // Time interval (s)
+    double *impactTime;         // Time of the step that reached the ground (s)
+    double *impactVelocity;     // Velocity at that step, before it is zeroed (m/s)
+    int *steps;                 // Steps taken
+    unsigned char *landed;      // 1 if the ground was reached within MAX_ITERATIONS
+} ScenarioSet;
+
+/**
+ * @brief Distribution of an uncertain parameter of a Monte Carlo run.
+ *
+ * A fixed value is held in first. A uniform distribution runs from first to
+ * second, a normal one has mean first and deviation second, and a lognormal
+ * one has median first and log deviation second.
+ */
+typedef struct {
+    int kind;                   // DIST_FIXED, DIST_UNIFORM, DIST_NORMAL or DIST_LOGNORMAL
+    double first;
+    double second;
+} Distribution;
+
+/**
+ * @brief Settings taken from the command line.
+ */
+typedef struct {
+    char *scenarioFile;         // Scenario file of a batch run, or NULL
+    int threads;                // Threads that step the scenarios
+    const char *kernelName;     // Kernel forced with --kernel, or NULL
+    const char *method;         // euler or rk45
+    double tolerance;           // Local error allowed per rk45 step
+    double benchHeight;         // Height of the benchmark drop, or 0 for no benchmark
+    double mass;                // Mass of the benchmark drop and of a written trajectory
+    char *queryFile;            // File of impact and height questions, or NULL
+    double scaleHeight;         // Height over which the air density falls by e (m), or 0 for constant density
+    int tablePoints;            // Intervals of each impact table
+    double tableHeight;         // Highest drop covered by the impact tables (m)
+    long monteCarloSamples;     // Drops of a Monte Carlo run, or 0 for no run
+    double height;              // Initial height of the Monte Carlo drops (m)
+    Distribution massDist;      // Distribution of the mass (kg)
+    Distribution dragDist;      // Distribution of the drag coefficient
+    Distribution densityDist;   // Distribution of the air density at the ground (kg/m^3)
+    uint64_t seed;              // Key of the Monte Carlo random generator
+    char *trajectoryFile;       // File that receives a trajectory, "-" for standard output, or NULL
+    const char *format;         // table, csv or binary
+    double interval;            // Time interval of the trajectory (s)
+    long every;                 // Steps between the written rows of the trajectory
+    double everyTime;           // Seconds between the written rows of the trajectory, or 0
+} ModelOptions;
+
+/**
+ * @brief Outcome of one drop.
+ */
+typedef struct {
+    double impactTime;          // Time when the ground was reached (s)
+    double impactVelocity;      // Velocity at that time (m/s)
+    int steps;                  // Steps taken
+    int rejected;               // Adaptive steps retried with a smaller interval
+    int landed;                 // 1 if the ground was reached within the step limit
+    double height;              // Height at the end of the drop (m), 0 once landed
+} DropResult;
+
+/**
+ * @brief Impact time and velocity of drops of one mass, sampled over the height.
+ *
+ * The samples are evenly spaced in the square root of the height, in which
+ * both curves are smooth down to the ground, and are interpolated with cubics.
+ */
+typedef struct {
+    double mass;                // Mass of the drops (kg)
+    int points;                 // Intervals between the samples
+    double spacing;             // Square root of the height between samples (m^0.5)
+    double *impactTime;         // Impact time of each sample (s)
+    double *impactVelocity;     // Impact velocity of each sample (m/s)
+} ImpactTable;
+
+/**
+ * @brief Number of impact questions asked about one mass that has no table.
+ */
+typedef struct {
+    double mass;                // Mass of the questions (kg), 0 for an unused counter
+    long questions;             // Questions asked since the mass last lost its table
+} MassCounter;
+
+typedef void (*SweepKernel)(ScenarioSet *set, long first, long count);
+
+/**
+ * @brief A sweep kernel and the name used to choose it.
+ */
+typedef struct {
+    const char *name;
+    SweepKernel sweep;
+} SweepKernels;
+
+/**
+ * @brief Work shared by the threads of a batch sweep.
+ */
+typedef struct {
+    ScenarioSet *set;
+    SweepKernel sweep;
+    long nextScenario;          // First scenario not yet claimed
+    pthread_mutex_t lock;
+} SweepJob;
 
-int main() {
+/**
+ * @brief Running mean and sum of squared deviations of a set of values.
+ */
+typedef struct {
+    long count;
+    double mean;
+    double m2;
+} RunningStats;
+
+/**
+ * @brief Work shared by the threads of a Monte Carlo run.
+ *
+ * Each chunk of samples has its own statistics, which are merged in chunk
+ * order once every chunk is done, so the totals do not depend on which
+ * thread took which chunk.
+ */
+typedef struct {
+    long samples;               // Drops to sample
+    double *impactTime;         // Impact time of each sample (s)
+    double *impactVelocity;     // Impact velocity of each sample (m/s)
+    RunningStats *timeStats;    // Statistics of the impact times of each chunk
+    RunningStats *velocityStats;// Statistics of the impact velocities of each chunk
+    long *unlanded;             // Samples of each chunk still falling at the step limit
+    long nextChunk;             // First chunk not yet claimed
+    pthread_mutex_t lock;
+} MonteCarloJob;
+
+/**
+ * @brief Buffered writer of the rows of a trajectory.
+ */
+typedef struct {
+    int fd;                     // Descriptor of the output file
+    int format;                 // FORMAT_TABLE, FORMAT_CSV or FORMAT_BINARY
+    char *buffer;               // TRAJECTORY_BUFFER_SIZE bytes waiting to be written
+    size_t used;                // Bytes of the buffer in use
+} TrajectoryWriter;
+
+// Declaration of functions
+void runInteractiveModel(void);
+void stepDrop(double *height, double *velocity, double mass, double time_interval);
+void dropEuler(double height, double mass, double time_interval, int maxSteps, DropResult *result);
+void dropAdaptive(double height, double mass, double firstStep, double tolerance, double stopTime,
+                  DropResult *result);
+void dropDerivative(const double state[2], double mass, double derivative[2]);
+double findGroundCrossing(const double dense[5]);
+double evaluateDense(const double dense[5], double theta);
+double airDensity(double height);
+void analyticImpact(double height, double mass, DropResult *result);
+void analyticState(double height, double mass, double time, DropResult *result);
+ImpactTable *findImpactTable(double mass);
+MassCounter *findMassCounter(double mass);
+void buildImpactTable(ImpactTable *table, double mass);
+void tableImpact(const ImpactTable *table, double height, DropResult *result);
+void answerQueries(const char *fileName);
+void runMonteCarlo(long samples, int threads);
+void *sampleMonteCarloChunks(void *arg);
+void sampleDrop(long sample, DropResult *result);
+double sampleDistribution(const Distribution *distribution, long sample, uint32_t parameter);
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4]);
+void parseDistribution(const char *spec, Distribution *distribution);
+void describeDistribution(const char *name, const Distribution *distribution);
+void addRunningStats(RunningStats *stats, double value);
+void mergeRunningStats(RunningStats *total, const RunningStats *part);
+void printSampleSummary(const char *label, double *values, long count, const RunningStats *stats);
+double selectValue(double *values, long count, long rank);
+void writeTrajectory(double height, double mass, double time_interval);
+void initTrajectoryWriter(TrajectoryWriter *writer, const char *fileName, const char *format);
+void writeTrajectoryRow(TrajectoryWriter *writer, double time, double height, double velocity);
+void flushTrajectory(TrajectoryWriter *writer);
+int formatFixed(char *dest, double value, int width, int decimals);
+int parseOptions(int argc, char *argv[]);
+void printUsage(void);
+void readScenarios(const char *fileName, ScenarioSet *set);
+void addScenario(ScenarioSet *set, double height, double mass, double time_interval);
+void freeScenarios(ScenarioSet *set);
+const SweepKernels *selectSweepKernels(const char *name);
+void sweepScenarios(ScenarioSet *set, SweepKernel sweep, int threads);
+void *sweepScenarioChunks(void *arg);
+void printScenarioSummary(const ScenarioSet *set);
+void sweepScalar(ScenarioSet *set, long first, long count);
+void sweepAdaptive(ScenarioSet *set, long first, long count);
+void benchmarkIntegrators(double height, double mass);
+double timeDrop(const char *method, double height, double mass, double setting, DropResult *result);
+double currentSeconds(void);
+#ifdef HAVE_X86_KERNELS
+void sweepSse2(ScenarioSet *set, long first, long count);
+void sweepAvx2(ScenarioSet *set, long first, long count);
+#endif
+
+ModelOptions options = {
+    NULL, 1, NULL, "euler", DEFAULT_TOLERANCE, 0.0, BENCH_MASS, NULL, 0.0, TABLE_POINTS, TABLE_HEIGHT,
+    0, 0.0, { DIST_FIXED, BENCH_MASS, 0 }, { DIST_FIXED, DRAG, 0 }, { DIST_FIXED, DENSITY, 0 }, 1,
+    NULL, "table", 0.01, 1, 0.0
+};
+
+// Impact tables built so far, reused for later questions about the same mass
+ImpactTable impactTables[TABLE_CACHE];
+int impactTableCount = 0;
+
+// Questions about masses without a table, counted until a table pays off
+MassCounter massCounters[MASS_COUNTERS];
+
+// Butcher tableau of the Dormand-Prince 5(4) pair; the last row holds the fifth-order weights
+const double dormandPrinceA[7][6] = {
+    { 0 },
+    { 1.0 / 5 },
+    { 3.0 / 40, 9.0 / 40 },
+    { 44.0 / 45, -56.0 / 15, 32.0 / 9 },
+    { 19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729 },
+    { 9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656 },
+    { 35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84 }
+};
+
+// Difference between the fifth- and fourth-order weights, which estimates the local error
+const double dormandPrinceE[7] = {
+    71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525, -1.0 / 40
+};
+
+// Weights of the fourth-order continuous extension used between the ends of a step
+const double dormandPrinceD[7] = {
+    -12715105075.0 / 11282082432, 0, 87487479700.0 / 32700410799, -10690763975.0 / 1880347072,
+    701980252875.0 / 199316789632, -1453857185.0 / 822651844, 69997945.0 / 29380423
+};
+
+// Sweep kernels for each instruction set, best first
+const SweepKernels sweepKernels[] = {
+#ifdef HAVE_X86_KERNELS
+    { "avx2", sweepAvx2 },
+    { "sse2", sweepSse2 },
+#endif
+    { "scalar", sweepScalar }
+};
+
+/**
+ * @brief main
+ *
+ * Without arguments the program asks for one scenario and prints its
+ * trajectory. With --batch it sweeps every scenario of a file and prints
+ * a summary of each, and with --bench it compares the two integrators.
+ *
+ * @param argc The number of command line arguments passed to the program.
+ * @param argv Array of command line arguments.
+ * @return int Exit status code; 0 indicates success; 1 indictates an error.
+ */
+int main(int argc, char *argv[]) {
+    ScenarioSet set = { 0 };
+    SweepKernel sweep = sweepAdaptive;
+
+    if (argc == 1) {
+        runInteractiveModel();
+        return 0;
+    }
+
+    parseOptions(argc, argv);
+    if (options.benchHeight > 0) {
+        benchmarkIntegrators(options.benchHeight, options.mass);
+        return 0;
+    }
+    if (options.queryFile != NULL) {
+        answerQueries(options.queryFile);
+        return 0;
+    }
+    if (options.monteCarloSamples > 0) {
+        runMonteCarlo(options.monteCarloSamples, options.threads);
+        return 0;
+    }
+    if (options.trajectoryFile != NULL) {
+        writeTrajectory(options.height, options.mass, options.interval);
+        return 0;
+    }
+    if (strcmp(options.method, "euler") == 0) {
+        sweep = selectSweepKernels(options.kernelName)->sweep;
+    }
+
+    readScenarios(options.scenarioFile, &set);
+    sweepScenarios(&set, sweep, options.threads);
+    printScenarioSummary(&set);
+    freeScenarios(&set);
+    return 0;
+}
+
+/**
+ * @brief Asks for one scenario and prints the height and velocity at every step.
+ */
+void runInteractiveModel(void) {
     // Input variables
     double mass;
     double initial_height, time_interval;
@@ -34,12 +418,12 @@ int main() {
     int loop_count = 0;
     double velocity = 0;
     double time_initial = 0;
-    double height, accel, drag_force; 
+    double height;
 
     // Prompt/receive user input for calculations
     printf("Please input initial height (m), mass (kg) and a time interval (s)\n"
            "to calculate the height and velocity of the falling object.\n");
-    
+
     // Check for valid user input, loop until input is valid
     do {
         printf("\nInitial Height (in meters): ");
@@ -72,14 +456,7 @@ int main() {
 
     // Loop to calculate height and velocity over time
     do {
-        // Calculates drag force and acceleration based on current velociy
-        drag_force = HALF * (CROSSAREA * DENSITY * DRAG * velocity * velocity);
-        accel = (mass * GRAVITY - drag_force) / mass;
-
-        // Updates velocity and height using acceleration from above equation
-        velocity += accel * time_interval;
-        height -= (velocity * time_interval) + 
-                  HALF * (accel * time_interval * time_interval);
+        stepDrop(&height, &velocity, mass, time_interval);
 
         // Sets velocity to 0 if height is 0 (object hit the ground)
         if(height <= 0){
@@ -92,10 +469,1807 @@ int main() {
         loop_count ++;
 
         printf("%8.2f     %8.2f     %12.2f\n", time_initial, height, velocity);
-    
+
     // Calculation loop continues aslong as height is greater than 0 and
     // the loop has not reached max iterations
     } while (height > 0 && loop_count < MAX_ITERATIONS);
 
     printf("\nThe object has hit the ground.\n");
-} // End of main
\ No newline at end of file
+}
+
+/**
+ * @brief Advances a falling object by one time interval.
+ *
+ * Every kernel repeats these operations in this order, so all of them give
+ * the same trajectory to the last bit.
+ *
+ * @param height Height of the object (m), updated in place.
+ * @param velocity Downward velocity of the object (m/s), updated in place.
+ * @param mass Mass of the object (kg).
+ * @param time_interval Length of the step (s).
+ */
+void stepDrop(double *height, double *velocity, double mass, double time_interval) {
+    // Calculates drag force and acceleration based on current velociy
+    double drag_force = HALF * (DRAG_FACTOR * *velocity * *velocity);
+    double accel = (mass * GRAVITY - drag_force) / mass;
+
+    // Updates velocity and height using acceleration from above equation
+    *velocity += accel * time_interval;
+    *height -= (*velocity * time_interval) +
+               HALF * (accel * time_interval * time_interval);
+}
+
+/**
+ * @brief Drops an object with the fixed-interval loop, without printing it.
+ *
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ * @param time_interval Length of every step (s).
+ * @param maxSteps Steps after which the object is left falling.
+ * @param result Receives the time, velocity and step of the first step that
+ *               reached the ground, or the last state if none did.
+ */
+void dropEuler(double height, double mass, double time_interval, int maxSteps, DropResult *result) {
+    double velocity = 0;
+    double time_initial = 0;
+    int loop_count = 0;
+
+    do {
+        stepDrop(&height, &velocity, mass, time_interval);
+        time_initial += time_interval;
+        loop_count++;
+    } while (height > 0 && loop_count < maxSteps);
+
+    result->impactTime = time_initial;
+    result->impactVelocity = velocity;
+    result->steps = loop_count;
+    result->rejected = 0;
+    result->landed = height <= 0;
+    result->height = height > 0 ? height : 0;
+}
+
+/**
+ * @brief Drops an object with an adaptive Dormand-Prince 5(4) integrator.
+ *
+ * Each step is taken with the fifth-order solution, and the difference from the
+ * embedded fourth-order one estimates its error. A step whose error is above
+ * the tolerance, relative to the size of the height and velocity, is retried
+ * with a smaller interval, and the next interval is chosen from the error of
+ * the last. When a step ends at or below the ground, the moment of impact is
+ * found within it on the continuous extension of the step, and a drop
+ * stopped early is read off the extension of the step that passes its end.
+ *
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ * @param firstStep Length of the first step tried (s).
+ * @param tolerance Local error allowed per step.
+ * @param stopTime Time at which to stop if the ground is not reached first
+ *                 (s), or INFINITY.
+ * @param result Receives the time and velocity of impact, or of the stop,
+ *               and the steps taken.
+ */
+void dropAdaptive(double height, double mass, double firstStep, double tolerance, double stopTime,
+                  DropResult *result) {
+    double state[2] = { height, 0 };
+    double slopes[7][2];
+    double elapsed = 0;
+    double step = firstStep;
+    int retried = 0;
+
+    memset(result, 0, sizeof(*result));
+    dropDerivative(state, mass, slopes[0]);
+
+    while (result->steps < ADAPTIVE_MAX_STEPS) {
+        double stage[2];
+        double error = 0;
+
+        // Stages 2 to 7; the last stage is evaluated at the fifth-order solution
+        for (int s = 1; s < 7; s++) {
+            for (int i = 0; i < 2; i++) {
+                double sum = 0;
+
+                for (int j = 0; j < s; j++) {
+                    sum += dormandPrinceA[s][j] * slopes[j][i];
+                }
+                stage[i] = state[i] + step * sum;
+            }
+            dropDerivative(stage, mass, slopes[s]);
+        }
+
+        for (int i = 0; i < 2; i++) {
+            double estimate = 0;
+
+            for (int j = 0; j < 7; j++) {
+                estimate += dormandPrinceE[j] * slopes[j][i];
+            }
+            double scale = tolerance + tolerance * fmax(fabs(state[i]), fabs(stage[i]));
+            error += (step * estimate / scale) * (step * estimate / scale);
+        }
+        error = sqrt(error / 2);
+
+        if (error > 1) {
+            step *= fmax(0.2, 0.9 * pow(error, -0.2));
+            result->rejected++;
+            retried = 1;
+            continue;
+        }
+        result->steps++;
+
+        if (stage[0] <= 0 || elapsed + step >= stopTime) {
+            double dense[2][5];
+
+            // Continuous extension of the step, as in Hairer's DOPRI5
+            for (int i = 0; i < 2; i++) {
+                double sum = 0;
+
+                for (int j = 0; j < 7; j++) {
+                    sum += dormandPrinceD[j] * slopes[j][i];
+                }
+                dense[i][0] = state[i];
+                dense[i][1] = stage[i] - state[i];
+                dense[i][2] = step * slopes[0][i] - dense[i][1];
+                dense[i][3] = dense[i][1] - step * slopes[6][i] - dense[i][2];
+                dense[i][4] = step * sum;
+            }
+
+            double theta = stage[0] <= 0 ? findGroundCrossing(dense[0]) : 1;
+            result->landed = stage[0] <= 0 && elapsed + theta * step <= stopTime;
+            if (!result->landed) {
+                theta = (stopTime - elapsed) / step;
+            }
+            result->impactTime = result->landed ? elapsed + theta * step : stopTime;
+            result->impactVelocity = evaluateDense(dense[1], theta);
+            result->height = result->landed ? 0 : evaluateDense(dense[0], theta);
+            return;
+        }
+
+        // The last stage is the first stage of the next step
+        state[0] = stage[0];
+        state[1] = stage[1];
+        memcpy(slopes[0], slopes[6], sizeof(slopes[0]));
+        elapsed += step;
+
+        double factor = error > 0 ? 0.9 * pow(error, -0.2) : 5;
+        step *= fmin(retried ? 1 : 5, fmax(0.2, factor));
+        retried = 0;
+    }
+
+    result->impactTime = elapsed;
+    result->impactVelocity = state[1];
+    result->height = state[0];
+}
+
+/**
+ * @brief Gives the rate of change of the height and velocity of a falling object.
+ *
+ * The drag follows the density of the air at the object's height.
+ *
+ * @param state The height (m) and downward velocity (m/s).
+ * @param mass Mass of the object (kg).
+ * @param derivative Receives the rates of change of the height and velocity.
+ */
+void dropDerivative(const double state[2], double mass, double derivative[2]) {
+    double drag_force = HALF * (DRAG_FACTOR * state[1] * state[1]);
+
+    if (options.scaleHeight > 0) {
+        drag_force *= airDensity(state[0]) / DENSITY;
+    }
+
+    derivative[0] = -state[1];
+    derivative[1] = (mass * GRAVITY - drag_force) / mass;
+}
+
+/**
+ * @brief Finds where the height reaches the ground within a step.
+ *
+ * The height starts above the ground and ends at or below it, so the crossing
+ * is bracketed; it is narrowed by regula falsi with the Illinois correction,
+ * which converges superlinearly but never leaves the bracket.
+ *
+ * @param dense The continuous extension of the height over the step.
+ * @return double The fraction of the step, from 0 to 1, where the height is 0.
+ */
+double findGroundCrossing(const double dense[5]) {
+    double low = 0, high = 1;
+    double lowHeight = dense[0], highHeight = evaluateDense(dense, 1);
+    int side = 0;
+
+    for (int i = 0; i < ROOT_ITERATIONS && highHeight != 0 && high - low > 1e-15; i++) {
+        double theta = (low * highHeight - high * lowHeight) / (highHeight - lowHeight);
+        double height = evaluateDense(dense, theta);
+
+        if (height > 0) {
+            low = theta;
+            lowHeight = height;
+            if (side == -1) {
+                highHeight /= 2;
+            }
+            side = -1;
+        } else {
+            high = theta;
+            highHeight = height;
+            if (side == 1) {
+                lowHeight /= 2;
+            }
+            side = 1;
+        }
+    }
+    return high;
+}
+
+/**
+ * @brief Evaluates the continuous extension of a step.
+ *
+ * @param dense The coefficients of the extension of one variable.
+ * @param theta The fraction of the step, from 0 to 1.
+ * @return double The value of the variable at that point of the step.
+ */
+double evaluateDense(const double dense[5], double theta) {
+    double rest = 1 - theta;
+
+    return dense[0] + theta * (dense[1] + rest * (dense[2] + theta * (dense[3] + rest * dense[4])));
+}
+
+/**
+ * @brief Gives the density of the air at a height.
+ *
+ * @param height Height above the ground (m).
+ * @return double DENSITY at the ground, falling exponentially over the scale
+ *                height, or DENSITY everywhere if no scale height was given.
+ */
+double airDensity(double height) {
+    if (options.scaleHeight > 0) {
+        return DENSITY * exp(-height / options.scaleHeight);
+    }
+    return DENSITY;
+}
+
+/**
+ * @brief Gives the time and velocity of impact of a drop from rest, in closed form.
+ *
+ * With drag k v^2, the terminal velocity is vt = sqrt(m g / k) and, with
+ * tau = vt / g, the velocity is v = vt tanh(t / tau) after falling
+ * vt tau ln(cosh(t / tau)). A drop from h therefore lands when
+ * cosh(t / tau) = e^x with x = h / (vt tau), at a velocity of
+ * vt sqrt(1 - e^-2x). acosh(e^x) is taken as x + ln(1 + sqrt(1 - e^-2x)),
+ * which does not overflow for tall drops.
+ *
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ * @param result Receives the time and velocity of impact.
+ */
+void analyticImpact(double height, double mass, DropResult *result) {
+    double terminal = sqrt(mass * GRAVITY / (HALF * DRAG_FACTOR));
+    double tau = terminal / GRAVITY;
+    double x = height / (terminal * tau);
+    double speedFraction = sqrt(-expm1(-2 * x));
+
+    memset(result, 0, sizeof(*result));
+    result->impactTime = tau * (x + log1p(speedFraction));
+    result->impactVelocity = terminal * speedFraction;
+    result->landed = 1;
+}
+
+/**
+ * @brief Gives the height and velocity of a drop from rest at a time, in closed form.
+ *
+ * See analyticImpact. ln(cosh(u)) is taken as u + ln(1 + e^-2u) - ln(2),
+ * which does not overflow late in tall drops. After the impact the object
+ * rests on the ground.
+ *
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ * @param time Time since the drop (s).
+ * @param result Receives the height and velocity at that time.
+ */
+void analyticState(double height, double mass, double time, DropResult *result) {
+    double terminal = sqrt(mass * GRAVITY / (HALF * DRAG_FACTOR));
+    double tau = terminal / GRAVITY;
+    double u = time / tau;
+    double fallen = terminal * tau * (u + log1p(exp(-2 * u)) - M_LN2);
+
+    analyticImpact(height, mass, result);
+    if (time < result->impactTime && fallen < height) {
+        result->impactTime = time;
+        result->impactVelocity = terminal * tanh(u);
+        result->height = height - fallen;
+        result->landed = 0;
+    } else {
+        result->impactVelocity = 0;
+    }
+}
+
+/**
+ * @brief Finds the impact table of a mass, building it once it pays off.
+ *
+ * A table costs about as much as --table-points direct drops, so it is only
+ * built once that many questions have been asked about the mass; until then
+ * the caller drops directly. Spending no more on building than was already
+ * spent without a table keeps the total within twice the cost of the best
+ * choice in hindsight, whether the masses repeat or not. Once TABLE_CACHE
+ * tables exist, the oldest is rebuilt for the new mass, and the mass that
+ * loses its table starts counting again.
+ *
+ * @param mass Mass (kg).
+ * @return ImpactTable* The impact table of the mass, or NULL to drop directly.
+ */
+ImpactTable *findImpactTable(double mass) {
+    for (int i = 0; i < impactTableCount && i < TABLE_CACHE; i++) {
+        if (impactTables[i].mass == mass) {
+            return &impactTables[i];
+        }
+    }
+
+    MassCounter *counter = findMassCounter(mass);
+    if (++counter->questions < options.tablePoints) {
+        return NULL;
+    }
+    counter->mass = 0;
+    counter->questions = 0;
+
+    ImpactTable *table = &impactTables[impactTableCount++ % TABLE_CACHE];
+    if (impactTableCount > TABLE_CACHE) {
+        // The evicted mass has to pay for its table again before it is rebuilt
+        MassCounter *evicted = findMassCounter(table->mass);
+        evicted->questions = 0;
+    }
+    buildImpactTable(table, mass);
+    return table;
+}
+
+/**
+ * @brief Finds the question counter of a mass.
+ *
+ * Each mass has one slot, picked by a hash of its bits. A different mass in
+ * the slot is replaced, so the count of a mass is only ever too low, and
+ * masses that are seldom asked about cannot crowd out a table that pays off.
+ *
+ * @param mass Mass (kg).
+ * @return MassCounter* The counter, holding the mass.
+ */
+MassCounter *findMassCounter(double mass) {
+    uint64_t bits;
+
+    memcpy(&bits, &mass, sizeof(bits));
+    // The top bits of the product depend on every bit of the mass, even for
+    // round masses whose low mantissa bits are all zero
+    MassCounter *counter = &massCounters[(bits * 0x9E3779B97F4A7C15ULL) >> (64 - MASS_COUNTER_BITS)];
+    if (counter->mass != mass) {
+        counter->mass = mass;
+        counter->questions = 0;
+    }
+    return counter;
+}
+
+/**
+ * @brief Fills an impact table with adaptive drops from each sample height.
+ *
+ * @param table The table, whose arrays are reused if it was built before.
+ * @param mass Mass (kg).
+ */
+void buildImpactTable(ImpactTable *table, double mass) {
+    int points = options.tablePoints;
+
+    table->mass = mass;
+    table->points = points;
+    table->spacing = sqrt(options.tableHeight) / points;
+    table->impactTime = realloc(table->impactTime, (points + 1) * sizeof(double));
+    table->impactVelocity = realloc(table->impactVelocity, (points + 1) * sizeof(double));
+    if (table->impactTime == NULL || table->impactVelocity == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    table->impactTime[0] = 0;
+    table->impactVelocity[0] = 0;
+    for (int i = 1; i <= points; i++) {
+        double root = i * table->spacing;
+        DropResult result;
+
+        dropAdaptive(root * root, mass, 0.01, TABLE_TOLERANCE, INFINITY, &result);
+        table->impactTime[i] = result.impactTime;
+        table->impactVelocity[i] = result.impactVelocity;
+    }
+}
+
+/**
+ * @brief Interpolates the time and velocity of impact from an impact table.
+ *
+ * The four samples around the height are joined by a cubic in the square root
+ * of the height.
+ *
+ * @param table The impact table of the mass.
+ * @param height Initial height (m), within the table.
+ * @param result Receives the time and velocity of impact.
+ */
+void tableImpact(const ImpactTable *table, double height, DropResult *result) {
+    double position = sqrt(height) / table->spacing;
+    int first = (int)position - 1;
+
+    if (first < 0) {
+        first = 0;
+    }
+    if (first > table->points - 3) {
+        first = table->points - 3;
+    }
+
+    // Lagrange weights of the samples first to first + 3
+    double x = position - first;
+    double weights[4] = {
+        -(x - 1) * (x - 2) * (x - 3) / 6,
+        x * (x - 2) * (x - 3) / 2,
+        -x * (x - 1) * (x - 3) / 2,
+        x * (x - 1) * (x - 2) / 6
+    };
+
+    memset(result, 0, sizeof(*result));
+    for (int i = 0; i < 4; i++) {
+        result->impactTime += weights[i] * table->impactTime[first + i];
+        result->impactVelocity += weights[i] * table->impactVelocity[first + i];
+    }
+    result->landed = 1;
+}
+
+/**
+ * @brief Answers every question of a question file.
+ *
+ * "impact HEIGHT MASS" prints the time and velocity of impact, and
+ * "height HEIGHT MASS TIME" prints the height and velocity at a time, one
+ * line per question. With constant air density both come from the closed
+ * form. Otherwise impact questions are interpolated from the impact table of
+ * the mass once it has one (see findImpactTable), and other questions are
+ * integrated with the adaptive integrator. Blank lines and lines starting
+ * with '#' are skipped. The program terminates if a question cannot be read.
+ *
+ * @param fileName Name of the question file, or "-" for standard input.
+ */
+void answerQueries(const char *fileName) {
+    FILE *inputFile = strcmp(fileName, "-") == 0 ? stdin : fopen(fileName, "r");
+    char *line = NULL;
+    size_t lineSize = 0;
+    long lineNumber = 0;
+
+    if (inputFile == NULL) {
+        fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", fileName);
+        exit(1);
+    }
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    while (getline(&line, &lineSize, inputFile) != -1) {
+        double values[3] = { 0 };
+        char *start = line + strspn(line, " \t\r\n");
+        char *end;
+        int impact, wanted, count = 0;
+
+        lineNumber++;
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        impact = strncmp(start, "impact", 6) == 0;
+        if (!impact && strncmp(start, "height", 6) != 0) {
+            fprintf(stderr, "Warning: Terminating program (unknown question on line %ld).\n", lineNumber);
+            exit(1);
+        }
+        wanted = impact ? 2 : 3;
+        start += 6;
+        for (; count < wanted; count++) {
+            values[count] = strtod(start, &end);
+            if (end == start) {
+                break;
+            }
+            start = end;
+        }
+        if (count < wanted || start[strspn(start, " \t\r\n")] != '\0' || !(values[0] > 0 && values[1] > 0) ||
+            values[2] < 0) {
+            fprintf(stderr, "Warning: Terminating program (could not read question on line %ld).\n", lineNumber);
+            exit(1);
+        }
+
+        DropResult result;
+        ImpactTable *table = NULL;
+        if (options.scaleHeight == 0) {
+            if (impact) {
+                analyticImpact(values[0], values[1], &result);
+            } else {
+                analyticState(values[0], values[1], values[2], &result);
+            }
+        } else if (impact && values[0] <= options.tableHeight && (table = findImpactTable(values[1])) != NULL) {
+            tableImpact(table, values[0], &result);
+        } else {
+            dropAdaptive(values[0], values[1], 0.01, TABLE_TOLERANCE, impact ? INFINITY : values[2], &result);
+            if (!impact && result.landed) {
+                result.impactVelocity = 0;
+            }
+        }
+
+        if (impact) {
+            printf("%.6f %.6f\n", result.impactTime, result.impactVelocity);
+        } else {
+            printf("%.6f %.6f\n", result.height, result.impactVelocity);
+        }
+    }
+
+    free(line);
+    if (inputFile != stdin) {
+        fclose(inputFile);
+    }
+}
+
+/**
+ * @brief Samples drops with uncertain parameters and prints a summary.
+ *
+ * The threads claim MONTE_CARLO_CHUNK samples at a time. Sample i always
+ * draws from counter i of the generator and is stored in slot i, and the
+ * statistics of the chunks are merged in chunk order, so the summary is the
+ * same for any number of threads.
+ *
+ * @param samples The number of drops.
+ * @param threads The number of threads to use.
+ */
+void runMonteCarlo(long samples, int threads) {
+    MonteCarloJob job = {0};
+    long chunks = (samples + MONTE_CARLO_CHUNK - 1) / MONTE_CARLO_CHUNK;
+    RunningStats timeStats = { 0 }, velocityStats = { 0 };
+    long unlanded = 0;
+
+    job.samples = samples;
+    job.impactTime = malloc(samples * sizeof(double));
+    job.impactVelocity = malloc(samples * sizeof(double));
+    job.timeStats = calloc(chunks, sizeof(RunningStats));
+    job.velocityStats = calloc(chunks, sizeof(RunningStats));
+    job.unlanded = calloc(chunks, sizeof(long));
+    if (job.impactTime == NULL || job.impactVelocity == NULL || job.timeStats == NULL ||
+        job.velocityStats == NULL || job.unlanded == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    double start = currentSeconds();
+    if (threads > chunks) {
+        threads = chunks;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    if (threads <= 1) {
+        sampleMonteCarloChunks(&job);
+    } else {
+        pthread_t *workers = malloc(threads * sizeof(*workers));
+        if (workers == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+            exit(1);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_create(&workers[i], NULL, sampleMonteCarloChunks, &job);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
+    }
+    pthread_mutex_destroy(&job.lock);
+    double elapsed = currentSeconds() - start;
+
+    for (long chunk = 0; chunk < chunks; chunk++) {
+        mergeRunningStats(&timeStats, &job.timeStats[chunk]);
+        mergeRunningStats(&velocityStats, &job.velocityStats[chunk]);
+        unlanded += job.unlanded[chunk];
+    }
+
+    printf("Monte Carlo: %ld drops from %.2f m, seed %llu\n", samples, options.height,
+           (unsigned long long)options.seed);
+    describeDistribution("Mass (kg)", &options.massDist);
+    describeDistribution("Drag coefficient", &options.dragDist);
+    describeDistribution("Air density (kg/m^3)", &options.densityDist);
+    if (options.scaleHeight > 0) {
+        printf("  Density scale height: %g m (adaptive drops, tolerance %g)\n", options.scaleHeight,
+               options.tolerance);
+    }
+    printf("\n%-22s %12s %12s %12s %12s %12s %12s %12s %12s\n", "", "Mean", "Std dev", "Min", "P5", "P50", "P95",
+           "P99", "Max");
+    printSampleSummary("Impact time (s)", job.impactTime, samples, &timeStats);
+    printSampleSummary("Impact velocity (m/s)", job.impactVelocity, samples, &velocityStats);
+    if (unlanded > 0) {
+        printf("\n%ld drops were still falling after %d steps and are summarized where they stopped.\n", unlanded,
+               ADAPTIVE_MAX_STEPS);
+    }
+    fprintf(stderr, "%ld drops in %.3f s on %d threads (%.1f M drops/s)\n", samples, elapsed,
+            threads > 1 ? threads : 1, samples / elapsed / 1e6);
+
+    free(job.impactTime);
+    free(job.impactVelocity);
+    free(job.timeStats);
+    free(job.velocityStats);
+    free(job.unlanded);
+}
+
+/**
+ * @brief Thread of runMonteCarlo; samples chunks of drops until none are left.
+ *
+ * @param arg The MonteCarloJob shared by the threads.
+ * @return void* Always NULL.
+ */
+void *sampleMonteCarloChunks(void *arg) {
+    MonteCarloJob *job = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        long chunk = job->nextChunk++;
+        pthread_mutex_unlock(&job->lock);
+
+        long first = chunk * MONTE_CARLO_CHUNK;
+        if (first >= job->samples) {
+            return NULL;
+        }
+        long last = job->samples - first < MONTE_CARLO_CHUNK ? job->samples : first + MONTE_CARLO_CHUNK;
+
+        for (long i = first; i < last; i++) {
+            DropResult result;
+
+            sampleDrop(i, &result);
+            job->impactTime[i] = result.impactTime;
+            job->impactVelocity[i] = result.impactVelocity;
+            addRunningStats(&job->timeStats[chunk], result.impactTime);
+            addRunningStats(&job->velocityStats[chunk], result.impactVelocity);
+            job->unlanded[chunk] += !result.landed;
+        }
+    }
+}
+
+/**
+ * @brief Draws the parameters of one sample and drops it.
+ *
+ * The drag force is k v^2 with k = HALF * CROSSAREA * density * drag, so a drop
+ * moves exactly like one with the default density and drag and a mass scaled
+ * by (DENSITY * DRAG) / (density * drag). That effective mass is dropped with
+ * the closed form, or with the adaptive integrator when the density changes
+ * with height.
+ *
+ * @param sample The number of the sample, which selects its random draws.
+ * @param result Receives the outcome of the drop.
+ */
+void sampleDrop(long sample, DropResult *result) {
+    double mass = sampleDistribution(&options.massDist, sample, 0);
+    double drag = sampleDistribution(&options.dragDist, sample, 1);
+    double density = sampleDistribution(&options.densityDist, sample, 2);
+    double effectiveMass = mass * (DENSITY * DRAG) / (density * drag);
+
+    if (options.scaleHeight > 0) {
+        dropAdaptive(options.height, effectiveMass, 0.01, options.tolerance, INFINITY, result);
+    } else {
+        analyticImpact(options.height, effectiveMass, result);
+    }
+}
+
+/**
+ * @brief Draws one parameter of one sample.
+ *
+ * The draw comes from the block of the Philox generator at counter
+ * (sample, parameter, attempt), keyed by the seed. Every parameter must be
+ * positive, so a draw that is not is made again with the next attempt.
+ *
+ * @param distribution The distribution of the parameter.
+ * @param sample The number of the sample.
+ * @param parameter Which parameter of the sample is drawn.
+ * @return double The drawn value.
+ */
+double sampleDistribution(const Distribution *distribution, long sample, uint32_t parameter) {
+    uint32_t key[2] = { (uint32_t)options.seed, (uint32_t)(options.seed >> 32) };
+
+    if (distribution->kind == DIST_FIXED) {
+        return distribution->first;
+    }
+
+    for (uint32_t attempt = 0;; attempt++) {
+        uint32_t counter[4] = { (uint32_t)sample, (uint32_t)((uint64_t)sample >> 32), parameter, attempt };
+        uint32_t bits[4];
+        double value;
+
+        philox4x32(counter, key, bits);
+        // Two uniforms in (0, 1), from 53 bits each
+        double first = ((((uint64_t)bits[0] << 32 | bits[1]) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+        double second = ((((uint64_t)bits[2] << 32 | bits[3]) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+
+        if (distribution->kind == DIST_UNIFORM) {
+            value = distribution->first + first * (distribution->second - distribution->first);
+        } else {
+            // Box-Muller transform
+            double normal = sqrt(-2 * log(first)) * cos(2 * M_PI * second);
+
+            if (distribution->kind == DIST_NORMAL) {
+                value = distribution->first + distribution->second * normal;
+            } else {
+                value = distribution->first * exp(distribution->second * normal);
+            }
+        }
+        if (value > 0) {
+            return value;
+        }
+    }
+}
+
+/**
+ * @brief Philox4x32-10 counter-based random generator.
+ *
+ * Each counter gives 128 random bits that depend only on the counter and the
+ * key, so any sample can be drawn by any thread in any order.
+ *
+ * @param counter The 128-bit counter.
+ * @param key The 64-bit key.
+ * @param result Receives the 128 random bits.
+ */
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4]) {
+    uint32_t words[4] = { counter[0], counter[1], counter[2], counter[3] };
+    uint32_t keys[2] = { key[0], key[1] };
+
+    for (int round = 0; round < 10; round++) {
+        uint64_t first = (uint64_t)0xD2511F53 * words[0];
+        uint64_t second = (uint64_t)0xCD9E8D57 * words[2];
+
+        words[0] = (uint32_t)(second >> 32) ^ words[1] ^ keys[0];
+        words[1] = (uint32_t)second;
+        words[2] = (uint32_t)(first >> 32) ^ words[3] ^ keys[1];
+        words[3] = (uint32_t)first;
+        keys[0] += 0x9E3779B9;
+        keys[1] += 0xBB67AE85;
+    }
+    memcpy(result, words, sizeof(words));
+}
+
+/**
+ * @brief Reads a distribution given on the command line.
+ *
+ * The program terminates if the distribution cannot be read or cannot give
+ * positive values.
+ *
+ * @param spec A value, uniform:LOW,HIGH, normal:MEAN,DEVIATION or
+ *             lognormal:MEDIAN,LOG_DEVIATION.
+ * @param distribution Receives the distribution.
+ */
+void parseDistribution(const char *spec, Distribution *distribution) {
+    static const char *const names[] = { "uniform:", "normal:", "lognormal:" };
+    static const int kinds[] = { DIST_UNIFORM, DIST_NORMAL, DIST_LOGNORMAL };
+    const char *text = spec;
+    char *end;
+
+    distribution->kind = DIST_FIXED;
+    for (int i = 0; i < 3; i++) {
+        if (strncmp(spec, names[i], strlen(names[i])) == 0) {
+            distribution->kind = kinds[i];
+            spec += strlen(names[i]);
+        }
+    }
+
+    distribution->first = strtod(spec, &end);
+    distribution->second = 0;
+    if (end != spec && distribution->kind != DIST_FIXED && *end == ',') {
+        spec = end + 1;
+        distribution->second = strtod(spec, &end);
+    } else if (distribution->kind != DIST_FIXED) {
+        end = (char *)spec;
+    }
+
+    if (end == spec || *end != '\0' || !(distribution->first > 0) || distribution->second < 0 ||
+        (distribution->kind == DIST_UNIFORM && !(distribution->second > distribution->first))) {
+        fprintf(stderr, "Warning: Terminating program (could not read distribution '%s').\n", text);
+        exit(1);
+    }
+}
+
+/**
+ * @brief Prints one uncertain parameter of a Monte Carlo run.
+ *
+ * @param name The name of the parameter.
+ * @param distribution Its distribution.
+ */
+void describeDistribution(const char *name, const Distribution *distribution) {
+    switch (distribution->kind) {
+    case DIST_UNIFORM:
+        printf("  %-22s uniform from %g to %g\n", name, distribution->first, distribution->second);
+        break;
+    case DIST_NORMAL:
+        printf("  %-22s normal, mean %g, deviation %g\n", name, distribution->first, distribution->second);
+        break;
+    case DIST_LOGNORMAL:
+        printf("  %-22s lognormal, median %g, log deviation %g\n", name, distribution->first, distribution->second);
+        break;
+    default:
+        printf("  %-22s fixed at %g\n", name, distribution->first);
+    }
+}
+
+/**
+ * @brief Folds one value into running statistics with Welford's update.
+ *
+ * @param stats The running statistics.
+ * @param value The new value.
+ */
+void addRunningStats(RunningStats *stats, double value) {
+    double delta = value - stats->mean;
+
+    stats->count++;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+}
+
+/**
+ * @brief Merges the running statistics of a part into those of the whole.
+ *
+ * @param total The running statistics of the whole, updated in place.
+ * @param part The running statistics of the part.
+ */
+void mergeRunningStats(RunningStats *total, const RunningStats *part) {
+    long count = total->count + part->count;
+
+    if (part->count == 0) {
+        return;
+    }
+    double delta = part->mean - total->mean;
+    total->mean += delta * part->count / count;
+    total->m2 += part->m2 + delta * delta * ((double)total->count * part->count / count);
+    total->count = count;
+}
+
+/**
+ * @brief Prints the mean, deviation, extremes and percentiles of one result.
+ *
+ * Percentiles use the nearest rank. The values are reordered.
+ *
+ * @param label What the values are.
+ * @param values The value of each sample.
+ * @param count The number of samples.
+ * @param stats The running statistics of the values.
+ */
+void printSampleSummary(const char *label, double *values, long count, const RunningStats *stats) {
+    static const double percents[] = { 5, 50, 95, 99 };
+    double deviation = count > 1 ? sqrt(stats->m2 / (count - 1)) : 0;
+
+    printf("%-22s %12.6f %12.6f", label, stats->mean, deviation);
+    printf(" %12.6f", selectValue(values, count, 0));
+    for (int i = 0; i < 4; i++) {
+        long rank = (long)ceil(percents[i] / 100 * count) - 1;
+
+        printf(" %12.6f", selectValue(values, count, rank < 0 ? 0 : rank));
+    }
+    printf(" %12.6f\n", selectValue(values, count, count - 1));
+}
+
+/**
+ * @brief Finds the value of a given rank with quickselect.
+ *
+ * @param values The values, which are partly reordered.
+ * @param count The number of values.
+ * @param rank The rank wanted, from 0 for the smallest.
+ * @return double The value that would be at that rank if the values were sorted.
+ */
+double selectValue(double *values, long count, long rank) {
+    long low = 0, high = count - 1;
+
+    while (low < high) {
+        double pivot = values[low + (high - low) / 2];
+        long i = low, j = high;
+
+        while (i <= j) {
+            while (values[i] < pivot) {
+                i++;
+            }
+            while (values[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                double swap = values[i];
+                values[i++] = values[j];
+                values[j--] = swap;
+            }
+        }
+        if (rank <= j) {
+            high = j;
+        } else if (rank >= i) {
+            low = i;
+        } else {
+            break;
+        }
+    }
+    return values[rank];
+}
+
+/**
+ * @brief Writes the trajectory of one drop.
+ *
+ * The drop is stepped like the interactive loop, with the height and velocity
+ * zeroed on landing, but without the MAX_ITERATIONS limit, so fine intervals
+ * reach the ground. A step that does not lower the height, because the interval
+ * is too small to register, would repeat forever, so it terminates the program.
+ * The first and last rows are always written; the rows in between are decimated
+ * by --every, or by --every-time at the first step at or after each multiple of
+ * DT, found from the step count so that rounding in the running time cannot
+ * move it.
+ *
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ * @param time_interval Length of every step (s).
+ */
+void writeTrajectory(double height, double mass, double time_interval) {
+    TrajectoryWriter writer;
+    double velocity = 0;
+    double time_initial = 0;
+    double nextRow = 1;         // Multiple of --every-time at which the next row is due
+    long loop_count = 0;
+
+    initTrajectoryWriter(&writer, options.trajectoryFile, options.format);
+    writeTrajectoryRow(&writer, time_initial, height, velocity);
+
+    do {
+        double lastHeight = height;
+
+        stepDrop(&height, &velocity, mass, time_interval);
+        if (height <= 0) {
+            height = 0;
+            velocity = 0;
+        } else if (height >= lastHeight) {
+            flushTrajectory(&writer);
+            fprintf(stderr, "Warning: Terminating program (the interval is too small to move the object).\n");
+            exit(1);
+        }
+        time_initial += time_interval;
+        loop_count++;
+
+        if (height == 0) {
+            writeTrajectoryRow(&writer, time_initial, height, velocity);
+        } else if (options.everyTime > 0) {
+            double rows = floor(loop_count * time_interval / options.everyTime + 1e-9);
+
+            if (rows >= nextRow) {
+                writeTrajectoryRow(&writer, time_initial, height, velocity);
+                nextRow = rows + 1;
+            }
+        } else if (loop_count % options.every == 0) {
+            writeTrajectoryRow(&writer, time_initial, height, velocity);
+        }
+    } while (height > 0);
+
+    flushTrajectory(&writer);
+    free(writer.buffer);
+    if (writer.fd != STDOUT_FILENO && close(writer.fd) != 0) {
+        fprintf(stderr, "Warning: Terminating program (could not write the trajectory).\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Opens the output of a trajectory and writes the header of its format.
+ *
+ * @param writer The writer to set up.
+ * @param fileName The output file, or "-" for standard output.
+ * @param format table, csv or binary.
+ */
+void initTrajectoryWriter(TrajectoryWriter *writer, const char *fileName, const char *format) {
+    writer->fd = strcmp(fileName, "-") == 0 ? STDOUT_FILENO : open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    writer->format = strcmp(format, "csv") == 0 ? FORMAT_CSV :
+                     strcmp(format, "binary") == 0 ? FORMAT_BINARY : FORMAT_TABLE;
+    writer->buffer = malloc(TRAJECTORY_BUFFER_SIZE);
+    writer->used = 0;
+
+    if (writer->fd < 0) {
+        fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", fileName);
+        exit(1);
+    }
+    if (writer->buffer == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    if (writer->format == FORMAT_TABLE) {
+        writer->used = sprintf(writer->buffer, "Time (s)    Height (m)    Velocity (m/s)\n");
+    } else if (writer->format == FORMAT_CSV) {
+        writer->used = sprintf(writer->buffer, "time_s,height_m,velocity_mps\n");
+    }
+}
+
+/**
+ * @brief Adds one row to a trajectory, writing the buffer out when it is full.
+ *
+ * Table rows match the interactive loop's printf("%8.2f     %8.2f     %12.2f\n")
+ * byte for byte; CSV rows hold six decimals; binary rows are three native
+ * doubles.
+ *
+ * @param writer The trajectory writer.
+ * @param time Time since the drop (s).
+ * @param height Height (m).
+ * @param velocity Velocity (m/s).
+ */
+void writeTrajectoryRow(TrajectoryWriter *writer, double time, double height, double velocity) {
+    char *row;
+
+    if (writer->used + TRAJECTORY_ROW > TRAJECTORY_BUFFER_SIZE) {
+        flushTrajectory(writer);
+    }
+    row = writer->buffer + writer->used;
+
+    if (writer->format == FORMAT_BINARY) {
+        double record[3] = { time, height, velocity };
+
+        memcpy(row, record, sizeof(record));
+        writer->used += sizeof(record);
+    } else if (writer->format == FORMAT_CSV) {
+        row += formatFixed(row, time, 0, 6);
+        *row++ = ',';
+        row += formatFixed(row, height, 0, 6);
+        *row++ = ',';
+        row += formatFixed(row, velocity, 0, 6);
+        *row++ = '\n';
+        writer->used = row - writer->buffer;
+    } else {
+        row += formatFixed(row, time, 8, 2);
+        memcpy(row, "     ", 5);
+        row += 5 + formatFixed(row + 5, height, 8, 2);
+        memcpy(row, "     ", 5);
+        row += 5 + formatFixed(row + 5, velocity, 12, 2);
+        *row++ = '\n';
+        writer->used = row - writer->buffer;
+    }
+}
+
+/**
+ * @brief Writes out the buffered rows of a trajectory.
+ *
+ * @param writer The trajectory writer.
+ */
+void flushTrajectory(TrajectoryWriter *writer) {
+    size_t written = 0;
+
+    while (written < writer->used) {
+        ssize_t count = write(writer->fd, writer->buffer + written, writer->used - written);
+
+        if (count <= 0) {
+            fprintf(stderr, "Warning: Terminating program (could not write the trajectory).\n");
+            exit(1);
+        }
+        written += count;
+    }
+    writer->used = 0;
+}
+
+/**
+ * @brief Formats a number like printf("%*.*f", width, decimals, value), but faster.
+ *
+ * The value is scaled by 10^decimals and rounded to an integer, whose digits
+ * are written directly. Scaling can be off by an ulp, which matters only when
+ * the scaled value lies almost exactly halfway between two integers; those
+ * values, very large ones and non-finite ones are left to snprintf, so the
+ * text always matches printf's correctly rounded output.
+ *
+ * @param dest Buffer of at least TRAJECTORY_FIELD characters.
+ * @param value The number to format.
+ * @param width Least characters written, padded with spaces on the left.
+ * @param decimals Digits after the decimal point, from 1 to 9.
+ * @return int The number of characters written, without a terminating null.
+ */
+int formatFixed(char *dest, double value, int width, int decimals) {
+    static const double scales[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    double scaled = fabs(value) * scales[decimals];
+    double fraction = scaled - floor(scaled);
+    char digits[32];
+    int count = 0;
+
+    if (!(scaled < FAST_FORMAT_LIMIT) || fabs(fraction - 0.5) < FAST_FORMAT_MARGIN) {
+        return snprintf(dest, TRAJECTORY_FIELD, "%*.*f", width, decimals, value);
+    }
+
+    // Digits of the rounded value, last first, with the decimal point in place
+    uint64_t rounded = (uint64_t)floor(scaled + 0.5);
+    for (int i = 0; i < decimals; i++) {
+        digits[count++] = '0' + rounded % 10;
+        rounded /= 10;
+    }
+    digits[count++] = '.';
+    do {
+        digits[count++] = '0' + rounded % 10;
+        rounded /= 10;
+    } while (rounded > 0);
+    if (signbit(value)) {
+        digits[count++] = '-';
+    }
+
+    int length = count < width ? width : count;
+    memset(dest, ' ', length - count);
+    for (int i = 0; i < count; i++) {
+        dest[length - 1 - i] = digits[i];
+    }
+    return length;
+}
+
+/**
+ * @brief Reads the options given on the command line.
+ *
+ * Supported options:
+ *   --batch FILE      Sweep the scenarios in FILE, or standard input for "-"
+ *   --threads N       Threads that step the scenarios (default: one per CPU)
+ *   --kernel NAME     Force the avx2, sse2 or scalar kernel (default: best available)
+ *   --method NAME     euler, the fixed-interval loop, or rk45 (default euler)
+ *   --tolerance TOL   Local error allowed per rk45 step (default 1e-6)
+ *   --bench HEIGHT    Compare the integrators on one drop from HEIGHT, then exit
+ *   --mass KG         Mass of the benchmark drop and of a trajectory (default 7)
+ *   --query FILE      Answer the impact and height questions in FILE, or standard input for "-"
+ *   --scale-height M  Let the air density fall by a factor of e every M meters of
+ *                     height (default 0: constant density)
+ *   --table-points N  Intervals of each impact table, and questions about a
+ *                     mass before it gets one (default 2048)
+ *   --table-height M  Highest drop covered by the impact tables (default 20000)
+ *   --monte-carlo N   Sample N drops with uncertain parameters and summarize them
+ *   --height M        Initial height of the Monte Carlo drops and of a trajectory
+ *   --mass-dist D     Distribution of the mass (default 7)
+ *   --drag-dist D     Distribution of the drag coefficient (default 0.5)
+ *   --density-dist D  Distribution of the air density at the ground (default 1.204)
+ *   --seed N          Seed of the Monte Carlo samples (default 1)
+ *   --trajectory FILE Write the trajectory of one drop to FILE, or standard output for "-"
+ *   --format F        table, csv or binary (default table)
+ *   --interval S      Time interval of the trajectory (default 0.01)
+ *   --every N         Write every Nth step of the trajectory (default 1)
+ *   --every-time DT   Write the first step at or after every DT seconds instead
+ * A distribution is a fixed value, uniform:LOW,HIGH, normal:MEAN,DEVIATION or
+ * lognormal:MEDIAN,LOG_DEVIATION.
+ * The program terminates if an option is unknown, is missing its value, or is
+ * out of range, or if there is nothing to run.
+ *
+ * @param argc The number of command line arguments passed to the program.
+ * @param argv Array of command line arguments.
+ * @return int The index of the first argument that is not an option.
+ */
+int parseOptions(int argc, char *argv[]) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 1;
+
+    options.threads = processors > 0 ? processors : 1;
+
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printUsage();
+            exit(0);
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Warning: Terminating program (missing value after %s).\n", argv[i]);
+            exit(1);
+        }
+
+        if (strcmp(argv[i], "--batch") == 0) {
+            options.scenarioFile = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--kernel") == 0) {
+            options.kernelName = argv[++i];
+        } else if (strcmp(argv[i], "--method") == 0) {
+            options.method = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0) {
+            options.tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            options.benchHeight = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mass") == 0) {
+            options.mass = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--query") == 0) {
+            options.queryFile = argv[++i];
+        } else if (strcmp(argv[i], "--scale-height") == 0) {
+            options.scaleHeight = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--table-points") == 0) {
+            options.tablePoints = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--table-height") == 0) {
+            options.tableHeight = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--monte-carlo") == 0) {
+            options.monteCarloSamples = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--height") == 0) {
+            options.height = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mass-dist") == 0) {
+            parseDistribution(argv[++i], &options.massDist);
+        } else if (strcmp(argv[i], "--drag-dist") == 0) {
+            parseDistribution(argv[++i], &options.dragDist);
+        } else if (strcmp(argv[i], "--density-dist") == 0) {
+            parseDistribution(argv[++i], &options.densityDist);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--trajectory") == 0) {
+            options.trajectoryFile = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0) {
+            options.format = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0) {
+            options.interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--every") == 0) {
+            options.every = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--every-time") == 0) {
+            options.everyTime = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Warning: Terminating program (unknown option '%s').\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if (i < argc || (options.scenarioFile == NULL && options.benchHeight <= 0 && options.queryFile == NULL &&
+                     options.monteCarloSamples <= 0 && options.trajectoryFile == NULL)) {
+        printUsage();
+        exit(1);
+    }
+    if (options.threads < 1 || !(options.tolerance > 0) || !(options.mass > 0) || options.benchHeight < 0 ||
+        options.scaleHeight < 0 || options.tablePoints < 4 || !(options.tableHeight > 0) ||
+        options.monteCarloSamples < 0 || !(options.interval > 0) || options.every < 1 || options.everyTime < 0 ||
+        ((options.monteCarloSamples > 0 || options.trajectoryFile != NULL) && !(options.height > 0))) {
+        fprintf(stderr, "Warning: Terminating program (option out of range).\n");
+        exit(1);
+    }
+    if (strcmp(options.method, "euler") != 0 && strcmp(options.method, "rk45") != 0) {
+        fprintf(stderr, "Warning: Terminating program (unknown method '%s').\n", options.method);
+        exit(1);
+    }
+    if (strcmp(options.format, "table") != 0 && strcmp(options.format, "csv") != 0 &&
+        strcmp(options.format, "binary") != 0) {
+        fprintf(stderr, "Warning: Terminating program (unknown format '%s').\n", options.format);
+        exit(1);
+    }
+    return i;
+}
+
+/**
+ * @brief Prints how to run the program.
+ */
+void printUsage(void) {
+    printf("Usage: ./AccelModel                 Ask for one scenario and print its trajectory\n"
+           "       ./AccelModel --batch FILE    Summarize every scenario in FILE (- for stdin)\n"
+           "       ./AccelModel --bench HEIGHT  Compare the integrators on one drop\n"
+           "       ./AccelModel --query FILE    Answer the questions in FILE (- for stdin)\n"
+           "       ./AccelModel --monte-carlo N --height M\n"
+           "                                    Summarize N drops with uncertain parameters\n"
+           "       ./AccelModel --trajectory FILE --height M\n"
+           "                                    Write the trajectory of one drop (- for stdout)\n"
+           "  --threads N       Threads that step the scenarios (default: one per CPU)\n"
+           "  --kernel NAME     avx2, sse2 or scalar (default: best available)\n"
+           "  --method NAME     euler (fixed interval) or rk45 (adaptive) (default euler)\n"
+           "  --tolerance TOL   Local error allowed per rk45 step (default %g)\n"
+           "  --mass KG         Mass of the benchmark drop and trajectory (default %g)\n"
+           "  --scale-height M  Air density falls by e every M meters (default: constant)\n"
+           "  --table-points N  Intervals of each impact table, and questions about a\n"
+           "                    mass before it gets one (default %d)\n"
+           "  --table-height M  Highest drop covered by the impact tables (default %g)\n"
+           "  --mass-dist D     Distribution of the mass (default %g)\n"
+           "  --drag-dist D     Distribution of the drag coefficient (default %g)\n"
+           "  --density-dist D  Distribution of the air density at the ground (default %g)\n"
+           "  --seed N          Seed of the Monte Carlo samples (default 1)\n"
+           "  --format F        Trajectory as table, csv or binary (default table)\n"
+           "  --interval S      Time interval of the trajectory (default 0.01)\n"
+           "  --every N         Write every Nth step of the trajectory (default 1)\n"
+           "  --every-time DT   Write one step per DT seconds of the trajectory instead\n"
+           "Each scenario line holds: height (m) mass (kg) time_interval (s)\n"
+           "With rk45 the time interval is only the first step tried.\n"
+           "Each question line holds: impact HEIGHT MASS, or height HEIGHT MASS TIME\n"
+           "A distribution is a value, uniform:LOW,HIGH, normal:MEAN,DEVIATION\n"
+           "or lognormal:MEDIAN,LOG_DEVIATION.\n",
+           DEFAULT_TOLERANCE, BENCH_MASS, TABLE_POINTS, TABLE_HEIGHT, BENCH_MASS, DRAG, DENSITY);
+}
+
+/**
+ * @brief Reads every scenario of a scenario file.
+ *
+ * Each line holds an initial height, a mass and a time interval, separated by
+ * white space. Blank lines and lines starting with '#' are skipped. The program
+ * terminates if a line cannot be read or holds a value that is not positive.
+ *
+ * @param fileName Name of the scenario file, or "-" for standard input.
+ * @param set The scenario set that receives the scenarios.
+ */
+void readScenarios(const char *fileName, ScenarioSet *set) {
+    FILE *inputFile = strcmp(fileName, "-") == 0 ? stdin : fopen(fileName, "r");
+    char *line = NULL;
+    size_t lineSize = 0;
+    long lineNumber = 0;
+
+    if (inputFile == NULL) {
+        fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", fileName);
+        exit(1);
+    }
+
+    while (getline(&line, &lineSize, inputFile) != -1) {
+        double initial_height, mass, time_interval;
+        char *start = line;
+        char *end;
+
+        lineNumber++;
+        start += strspn(start, " \t\r\n");
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        initial_height = strtod(start, &end);
+        if (end != start) {
+            mass = strtod(start = end, &end);
+        }
+        if (end != start) {
+            time_interval = strtod(start = end, &end);
+        }
+        if (end == start || end[strspn(end, " \t\r\n")] != '\0') {
+            fprintf(stderr, "Warning: Terminating program (could not read scenario on line %ld).\n", lineNumber);
+            exit(1);
+        }
+        if (!(initial_height > 0 && mass > 0 && time_interval > 0)) {
+            fprintf(stderr, "Warning: Terminating program (scenario on line %ld is not positive).\n", lineNumber);
+            exit(1);
+        }
+        addScenario(set, initial_height, mass, time_interval);
+    }
+
+    free(line);
+    if (inputFile != stdin) {
+        fclose(inputFile);
+    }
+}
+
+/**
+ * @brief Appends a scenario to a scenario set, growing its arrays as needed.
+ *
+ * @param set The scenario set.
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ * @param time_interval Time interval (s).
+ */
+void addScenario(ScenarioSet *set, double height, double mass, double time_interval) {
+    if (set->count == set->capacity) {
+        long capacity = set->capacity ? set->capacity * 2 : 4096;
+
+        set->height = realloc(set->height, capacity * sizeof(double));
+        set->mass = realloc(set->mass, capacity * sizeof(double));
+        set->interval = realloc(set->interval, capacity * sizeof(double));
+        set->impactTime = realloc(set->impactTime, capacity * sizeof(double));
+        set->impactVelocity = realloc(set->impactVelocity, capacity * sizeof(double));
+        set->steps = realloc(set->steps, capacity * sizeof(int));
+        set->landed = realloc(set->landed, capacity);
+        if (set->height == NULL || set->mass == NULL || set->interval == NULL || set->impactTime == NULL ||
+            set->impactVelocity == NULL || set->steps == NULL || set->landed == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+            exit(1);
+        }
+        set->capacity = capacity;
+    }
+
+    set->height[set->count] = height;
+    set->mass[set->count] = mass;
+    set->interval[set->count] = time_interval;
+    set->count++;
+}
+
+/**
+ * @brief Frees the arrays of a scenario set.
+ *
+ * @param set The scenario set.
+ */
+void freeScenarios(ScenarioSet *set) {
+    free(set->height);
+    free(set->mass);
+    free(set->interval);
+    free(set->impactTime);
+    free(set->impactVelocity);
+    free(set->steps);
+    free(set->landed);
+}
+
+/**
+ * @brief Chooses the sweep kernel.
+ *
+ * @param name The kernel asked for with --kernel, or NULL for the fastest one
+ *             that this CPU supports.
+ * @return const SweepKernels* The chosen kernel.
+ */
+const SweepKernels *selectSweepKernels(const char *name) {
+    int kernelCount = sizeof(sweepKernels) / sizeof(sweepKernels[0]);
+
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+#endif
+    for (int i = 0; i < kernelCount; i++) {
+        int supported = 1;
+
+#ifdef HAVE_X86_KERNELS
+        if (strcmp(sweepKernels[i].name, "avx2") == 0) {
+            supported = __builtin_cpu_supports("avx2");
+        } else if (strcmp(sweepKernels[i].name, "sse2") == 0) {
+            supported = __builtin_cpu_supports("sse2");
+        }
+#endif
+        if (name == NULL ? supported : strcmp(name, sweepKernels[i].name) == 0) {
+            if (!supported) {
+                fprintf(stderr, "Warning: Terminating program (this CPU does not support %s).\n", name);
+                exit(1);
+            }
+            return &sweepKernels[i];
+        }
+    }
+
+    fprintf(stderr, "Warning: Terminating program (unknown kernel '%s').\n", name);
+    exit(1);
+}
+
+/**
+ * @brief Steps every scenario of a set to the ground.
+ *
+ * The threads claim SWEEP_CHUNK scenarios at a time and write each result to
+ * the scenario's own slot, so the results do not depend on the thread count.
+ *
+ * @param set The scenario set.
+ * @param sweep The kernel that steps the scenarios.
+ * @param threads The number of threads to use.
+ */
+void sweepScenarios(ScenarioSet *set, SweepKernel sweep, int threads) {
+    SweepJob job = {0};
+    long chunks = (set->count + SWEEP_CHUNK - 1) / SWEEP_CHUNK;
+
+    job.set = set;
+    job.sweep = sweep;
+
+    if (threads > chunks) {
+        threads = chunks;
+    }
+    if (threads <= 1) {
+        sweep(set, 0, set->count);
+        return;
+    }
+
+    pthread_t *workers = malloc(threads * sizeof(*workers));
+    if (workers == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, sweepScenarioChunks, &job);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+    free(workers);
+}
+
+/**
+ * @brief Thread of sweepScenarios; steps chunks of scenarios until none are left.
+ *
+ * @param arg The SweepJob shared by the threads.
+ * @return void* Always NULL.
+ */
+void *sweepScenarioChunks(void *arg) {
+    SweepJob *job = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        long first = job->nextScenario;
+        job->nextScenario += SWEEP_CHUNK;
+        pthread_mutex_unlock(&job->lock);
+
+        if (first >= job->set->count) {
+            return NULL;
+        }
+        long count = job->set->count - first < SWEEP_CHUNK ? job->set->count - first : SWEEP_CHUNK;
+        job->sweep(job->set, first, count);
+    }
+}
+
+/**
+ * @brief Prints one summary line for each scenario.
+ *
+ * Scenarios still falling after MAX_ITERATIONS steps show dashes in place of
+ * the impact time and velocity.
+ *
+ * @param set The swept scenario set.
+ */
+void printScenarioSummary(const ScenarioSet *set) {
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+    printf("Scenario    Impact time (s)    Impact velocity (m/s)    Steps\n");
+
+    for (long i = 0; i < set->count; i++) {
+        if (set->landed[i]) {
+            printf("%8ld    %15.6f    %21.6f    %5d\n", i + 1, set->impactTime[i], set->impactVelocity[i], set->steps[i]);
+        } else {
+            printf("%8ld    %15s    %21s    %5d\n", i + 1, "-", "-", set->steps[i]);
+        }
+    }
+}
+
+/**
+ * @brief Steps scenarios one at a time with stepDrop.
+ *
+ * @param set The scenario set.
+ * @param first The first scenario to step.
+ * @param count The number of scenarios to step.
+ */
+void sweepScalar(ScenarioSet *set, long first, long count) {
+    for (long i = first; i < first + count; i++) {
+        DropResult result;
+
+        dropEuler(set->height[i], set->mass[i], set->interval[i], MAX_ITERATIONS, &result);
+        set->impactTime[i] = result.impactTime;
+        set->impactVelocity[i] = result.impactVelocity;
+        set->steps[i] = result.steps;
+        set->landed[i] = result.landed;
+    }
+}
+
+/**
+ * @brief Steps scenarios one at a time with the adaptive integrator.
+ *
+ * The steps of different scenarios diverge as soon as their errors differ, so
+ * this kernel does not use vector lanes.
+ *
+ * @param set The scenario set.
+ * @param first The first scenario to step.
+ * @param count The number of scenarios to step.
+ */
+void sweepAdaptive(ScenarioSet *set, long first, long count) {
+    for (long i = first; i < first + count; i++) {
+        DropResult result;
+
+        dropAdaptive(set->height[i], set->mass[i], set->interval[i], options.tolerance, INFINITY, &result);
+        set->impactTime[i] = result.impactTime;
+        set->impactVelocity[i] = result.impactVelocity;
+        set->steps[i] = result.steps;
+        set->landed[i] = result.landed;
+    }
+}
+
+/**
+ * @brief Compares the fixed-interval loop with the adaptive integrator on one drop.
+ *
+ * The reference impact comes from the adaptive integrator at a tolerance of
+ * 1e-13. The loop is run without the MAX_ITERATIONS limit so that its small
+ * intervals reach the ground. For each interval and tolerance the steps, the
+ * errors of the impact time and velocity, and the time per drop are printed,
+ * followed by the cheapest setting of each integrator that reaches a few
+ * impact time errors.
+ *
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ */
+void benchmarkIntegrators(double height, double mass) {
+    static const double intervals[] = { 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7 };
+    static const double tolerances[] = { 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9, 1e-10, 1e-11 };
+    static const double targets[] = { 1e-2, 1e-4, 1e-6, 1e-8 };
+    int intervalCount = sizeof(intervals) / sizeof(intervals[0]);
+    int toleranceCount = sizeof(tolerances) / sizeof(tolerances[0]);
+    int targetCount = sizeof(targets) / sizeof(targets[0]);
+    double timeErrors[2][16], seconds[2][16];
+    int steps[2][16];
+    DropResult reference, result;
+
+    dropAdaptive(height, mass, 0.01, 1e-13, INFINITY, &reference);
+    printf("Integrator benchmark: height %.2f m, mass %.2f kg\n", height, mass);
+    printf("Reference impact: %.12f s at %.12f m/s (rk45, tolerance 1e-13)\n\n", reference.impactTime,
+           reference.impactVelocity);
+    printf("  Method  Setting      Steps  Rejected  Time error (s)  Velocity error (m/s)  Time per drop\n");
+
+    for (int method = 0; method < 2; method++) {
+        int count = method == 0 ? intervalCount : toleranceCount;
+
+        for (int i = 0; i < count; i++) {
+            double setting = method == 0 ? intervals[i] : tolerances[i];
+
+            seconds[method][i] = timeDrop(method == 0 ? "euler" : "rk45", height, mass, setting, &result);
+            timeErrors[method][i] = fabs(result.impactTime - reference.impactTime);
+            steps[method][i] = result.steps;
+            printf("  %-6s  %-5s %.0e  %9d  %8d  %14.3e  %20.3e  %10.3f us\n", method == 0 ? "euler" : "rk45",
+                   method == 0 ? "dt" : "tol", setting, result.steps, result.rejected, timeErrors[method][i],
+                   fabs(result.impactVelocity - reference.impactVelocity), seconds[method][i] * 1e6);
+        }
+    }
+
+    printf("\nCheapest setting reaching each impact time error:\n");
+    for (int t = 0; t < targetCount; t++) {
+        printf("  %.0e s:", targets[t]);
+        for (int method = 0; method < 2; method++) {
+            int count = method == 0 ? intervalCount : toleranceCount;
+            int best = -1;
+
+            for (int i = 0; i < count; i++) {
+                if (timeErrors[method][i] <= targets[t] && (best < 0 || seconds[method][i] < seconds[method][best])) {
+                    best = i;
+                }
+            }
+            if (best < 0) {
+                printf("  %s not reached", method == 0 ? "euler" : "rk45");
+            } else {
+                printf("  %s %d steps in %.3f us", method == 0 ? "euler" : "rk45", steps[method][best],
+                       seconds[method][best] * 1e6);
+            }
+            printf(method == 0 ? "," : "\n");
+        }
+    }
+}
+
+/**
+ * @brief Times one drop, repeating it for at least BENCH_SECONDS.
+ *
+ * @param method euler or rk45.
+ * @param height Initial height (m).
+ * @param mass Mass (kg).
+ * @param setting The time interval of euler, or the tolerance of rk45.
+ * @param result Receives the outcome of the drop.
+ * @return double The average seconds per drop.
+ */
+double timeDrop(const char *method, double height, double mass, double setting, DropResult *result) {
+    double start = currentSeconds();
+    double elapsed;
+    long repeats = 0;
+
+    do {
+        if (strcmp(method, "euler") == 0) {
+            dropEuler(height, mass, setting, INT_MAX, result);
+        } else {
+            dropAdaptive(height, mass, 0.01, setting, INFINITY, result);
+        }
+        repeats++;
+        elapsed = currentSeconds() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    return elapsed / repeats;
+}
+
+/**
+ * @brief Returns a monotonic clock reading in seconds, for timing.
+ *
+ * @return double The current time in seconds.
+ */
+double currentSeconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+#ifdef HAVE_X86_KERNELS
+/**
+ * @brief SSE2 version of sweepScalar, two scenarios per vector.
+ *
+ * SWEEP_TILE scenarios are stepped together. A lane stops changing once its
+ * height reaches the ground, so its state then holds the impact values, and
+ * a vector is skipped once all of its lanes have landed.
+ */
+__attribute__((target("sse2")))
+void sweepSse2(ScenarioSet *set, long first, long count) {
+    const __m128d half = _mm_set1_pd(HALF);
+    const __m128d dragFactor = _mm_set1_pd(DRAG_FACTOR);
+    const __m128d gravity = _mm_set1_pd(GRAVITY);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+
+    for (long tile = first; tile < first + count; tile += SWEEP_TILE) {
+        int lanes = first + count - tile < SWEEP_TILE ? first + count - tile : SWEEP_TILE;
+        double height[SWEEP_TILE] = { 0 }, mass[SWEEP_TILE], interval[SWEEP_TILE];
+        __m128d h[SWEEP_TILE / 2], v[SWEEP_TILE / 2], m[SWEEP_TILE / 2], dt[SWEEP_TILE / 2];
+        __m128d t[SWEEP_TILE / 2], steps[SWEEP_TILE / 2], active[SWEEP_TILE / 2];
+
+        // Unused lanes start on the ground, so they are never stepped
+        for (int i = 0; i < SWEEP_TILE; i++) {
+            mass[i] = 1.0;
+            interval[i] = 1.0;
+        }
+        memcpy(height, set->height + tile, lanes * sizeof(double));
+        memcpy(mass, set->mass + tile, lanes * sizeof(double));
+        memcpy(interval, set->interval + tile, lanes * sizeof(double));
+        for (int j = 0; j < SWEEP_TILE / 2; j++) {
+            h[j] = _mm_loadu_pd(height + 2 * j);
+            m[j] = _mm_loadu_pd(mass + 2 * j);
+            dt[j] = _mm_loadu_pd(interval + 2 * j);
+            v[j] = t[j] = steps[j] = zero;
+            active[j] = _mm_cmpgt_pd(h[j], zero);
+        }
+
+        for (int loop_count = 0; loop_count < MAX_ITERATIONS; loop_count++) {
+            int moving = 0;
+
+            for (int j = 0; j < SWEEP_TILE / 2; j++) {
+                if (_mm_movemask_pd(active[j]) == 0) {
+                    continue;
+                }
+                __m128d drag_force = _mm_mul_pd(half, _mm_mul_pd(_mm_mul_pd(dragFactor, v[j]), v[j]));
+                __m128d accel = _mm_div_pd(_mm_sub_pd(_mm_mul_pd(m[j], gravity), drag_force), m[j]);
+                __m128d velocity = _mm_add_pd(v[j], _mm_mul_pd(accel, dt[j]));
+                __m128d fall = _mm_add_pd(_mm_mul_pd(velocity, dt[j]),
+                                          _mm_mul_pd(half, _mm_mul_pd(_mm_mul_pd(accel, dt[j]), dt[j])));
+
+                // Only lanes still in the air take the step
+                v[j] = _mm_or_pd(_mm_and_pd(active[j], velocity), _mm_andnot_pd(active[j], v[j]));
+                h[j] = _mm_sub_pd(h[j], _mm_and_pd(active[j], fall));
+                t[j] = _mm_add_pd(t[j], _mm_and_pd(active[j], dt[j]));
+                steps[j] = _mm_add_pd(steps[j], _mm_and_pd(active[j], one));
+                active[j] = _mm_and_pd(active[j], _mm_cmpgt_pd(h[j], zero));
+                moving |= _mm_movemask_pd(active[j]);
+            }
+            if (!moving) {
+                break;
+            }
+        }
+
+        double laneHeight[SWEEP_TILE], laneTime[SWEEP_TILE], laneVelocity[SWEEP_TILE], laneSteps[SWEEP_TILE];
+        for (int j = 0; j < SWEEP_TILE / 2; j++) {
+            _mm_storeu_pd(laneHeight + 2 * j, h[j]);
+            _mm_storeu_pd(laneTime + 2 * j, t[j]);
+            _mm_storeu_pd(laneVelocity + 2 * j, v[j]);
+            _mm_storeu_pd(laneSteps + 2 * j, steps[j]);
+        }
+        for (int i = 0; i < lanes; i++) {
+            set->impactTime[tile + i] = laneTime[i];
+            set->impactVelocity[tile + i] = laneVelocity[i];
+            set->steps[tile + i] = (int)laneSteps[i];
+            set->landed[tile + i] = laneHeight[i] <= 0;
+        }
+    }
+}
+
+/**
+ * @brief AVX2 version of sweepScalar, four scenarios per vector.
+ *
+ * Works like sweepSse2, with the same rounding in every lane.
+ */
+__attribute__((target("avx2")))
+void sweepAvx2(ScenarioSet *set, long first, long count) {
+    const __m256d half = _mm256_set1_pd(HALF);
+    const __m256d dragFactor = _mm256_set1_pd(DRAG_FACTOR);
+    const __m256d gravity = _mm256_set1_pd(GRAVITY);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    for (long tile = first; tile < first + count; tile += SWEEP_TILE) {
+        int lanes = first + count - tile < SWEEP_TILE ? first + count - tile : SWEEP_TILE;
+        double height[SWEEP_TILE] = { 0 }, mass[SWEEP_TILE], interval[SWEEP_TILE];
+        __m256d h[SWEEP_TILE / 4], v[SWEEP_TILE / 4], m[SWEEP_TILE / 4], dt[SWEEP_TILE / 4];
+        __m256d t[SWEEP_TILE / 4], steps[SWEEP_TILE / 4], active[SWEEP_TILE / 4];
+
+        // Unused lanes start on the ground, so they are never stepped
+        for (int i = 0; i < SWEEP_TILE; i++) {
+            mass[i] = 1.0;
+            interval[i] = 1.0;
+        }
+        memcpy(height, set->height + tile, lanes * sizeof(double));
+        memcpy(mass, set->mass + tile, lanes * sizeof(double));
+        memcpy(interval, set->interval + tile, lanes * sizeof(double));
+        for (int j = 0; j < SWEEP_TILE / 4; j++) {
+            h[j] = _mm256_loadu_pd(height + 4 * j);
+            m[j] = _mm256_loadu_pd(mass + 4 * j);
+            dt[j] = _mm256_loadu_pd(interval + 4 * j);
+            v[j] = t[j] = steps[j] = zero;
+            active[j] = _mm256_cmp_pd(h[j], zero, _CMP_GT_OQ);
+        }
+
+        for (int loop_count = 0; loop_count < MAX_ITERATIONS; loop_count++) {
+            int moving = 0;
+
+            for (int j = 0; j < SWEEP_TILE / 4; j++) {
+                if (_mm256_movemask_pd(active[j]) == 0) {
+                    continue;
+                }
+                __m256d drag_force = _mm256_mul_pd(half, _mm256_mul_pd(_mm256_mul_pd(dragFactor, v[j]), v[j]));
+                __m256d accel = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(m[j], gravity), drag_force), m[j]);
+                __m256d velocity = _mm256_add_pd(v[j], _mm256_mul_pd(accel, dt[j]));
+                __m256d fall = _mm256_add_pd(_mm256_mul_pd(velocity, dt[j]),
+                                             _mm256_mul_pd(half, _mm256_mul_pd(_mm256_mul_pd(accel, dt[j]), dt[j])));
+
+                // Only lanes still in the air take the step
+                v[j] = _mm256_blendv_pd(v[j], velocity, active[j]);
+                h[j] = _mm256_sub_pd(h[j], _mm256_and_pd(active[j], fall));
+                t[j] = _mm256_add_pd(t[j], _mm256_and_pd(active[j], dt[j]));
+                steps[j] = _mm256_add_pd(steps[j], _mm256_and_pd(active[j], one));
+                active[j] = _mm256_and_pd(active[j], _mm256_cmp_pd(h[j], zero, _CMP_GT_OQ));
+                moving |= _mm256_movemask_pd(active[j]);
+            }
+            if (!moving) {
+                break;
+            }
+        }
+
+        double laneHeight[SWEEP_TILE], laneTime[SWEEP_TILE], laneVelocity[SWEEP_TILE], laneSteps[SWEEP_TILE];
+        for (int j = 0; j < SWEEP_TILE / 4; j++) {
+            _mm256_storeu_pd(laneHeight + 4 * j, h[j]);
+            _mm256_storeu_pd(laneTime + 4 * j, t[j]);
+            _mm256_storeu_pd(laneVelocity + 4 * j, v[j]);
+            _mm256_storeu_pd(laneSteps + 4 * j, steps[j]);
+        }
+        for (int i = 0; i < lanes; i++) {
+            set->impactTime[tile + i] = laneTime[i];
+            set->impactVelocity[tile + i] = laneVelocity[i];
+            set->steps[tile + i] = (int)laneSteps[i];
+            set->landed[tile + i] = laneHeight[i] <= 0;
+        }
+    }
+}
+#endif
@@ -1,11 +1,11 @@
-/*  
+/*
 *   Dylan Baker
 *   C0484294
 *   COMP-166-001
 *   Oct 20, 2024
 *
 *                       Function: Matrix.c
-*           Computes and prints a user-defined matrix. 
+*           Computes and prints a user-defined matrix.
 *           User chooses matrix shape, size, and design.
 *
 *                           #               Shape: Pyramid
@@ -13,25 +13,148 @@
 *                         #####             Symbol: #
 *
 *                    Ctrl-C exits program loop
+*
+*           ./Matrix SIZE SYMBOL SHAPE prints one matrix without the
+*           prompts. Every row is a slice of one template row, copied
+*           into a large block that is written at once, instead of one
+*           printf per character. ./Matrix --bench SIZE times that
+*           renderer against the printf renderer for each shape.
+*
+*           ./Matrix --output FILE [--threads N] SIZE SYMBOL SHAPE
+*           renders straight into FILE. The byte offset of every row is
+*           known in closed form, so the file is sized and mapped first
+*           and the threads fill disjoint rows of it at the same time.
+*
+*           Build with: gcc -O2 -pthread -o Matrix Matrix.c
 */
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define MATRIX_BLOCK_SIZE (1 << 20)         // Bytes of rows gathered before each write
+#define BENCH_VERIFY_LIMIT (64 << 20)       // Largest output compared byte for byte by --bench
+#define MATRIX_ROW_CHUNK 64                 // Rows a thread of --output claims at a time
 
 // Defines constant strings for matrix shapes
 const char *STAIRCASE = "staircase";
 const char *PYRAMID = "pyramid";
 const char *DIAMOND = "diamond";
 
-int main() {
+/**
+ * @brief Rows of a matrix gathered in a block before they are written.
+ */
+typedef struct {
+    FILE *outputFile;           // Where the rows are written
+    char *block;                // MATRIX_BLOCK_SIZE bytes waiting to be written
+    size_t used;                // Bytes of the block in use
+} MatrixWriter;
+
+/**
+ * @brief Work shared by the threads that render a matrix into a mapped file.
+ */
+typedef struct {
+    char *output;               // The mapped output file
+    const char *shape;          // staircase, pyramid or diamond
+    int size;                   // The size of the matrix
+    char symbol;                // The character the matrix is drawn with
+    long rows;                  // Rows in the matrix
+    long nextChunk;             // First chunk of MATRIX_ROW_CHUNK rows not yet claimed
+    pthread_mutex_t lock;       // Guards nextChunk
+} MatrixFileJob;
+
+// Declaration of functions
+void runInteractiveMatrix(void);
+int isMatrixShape(const char *shape);
+void renderMatrix(FILE *outputFile, const char *shape, int size, char symbol);
+void writeMatrixRow(MatrixWriter *writer, const char *row, size_t length);
+void flushMatrixRows(MatrixWriter *writer);
+void renderMatrixLegacy(FILE *outputFile, const char *shape, int size, char symbol);
+size_t matrixSize(const char *shape, int size);
+long matrixRowCount(const char *shape, int size);
+size_t matrixRowOffset(const char *shape, int size, long row);
+void matrixRowLayout(const char *shape, int size, long row, size_t *spaces, size_t *symbols);
+void renderMatrixFile(const char *outputName, const char *shape, int size, char symbol, int threads);
+void *fillMatrixRows(void *arg);
+void benchmarkRenderers(int size);
+double currentSeconds(void);
+
+/**
+ * @brief main
+ *
+ * Without arguments the program asks for matrices until it is stopped. With
+ * SIZE SYMBOL SHAPE it prints that matrix once, or writes it to the file
+ * given with --output, and with --bench SIZE it compares the renderers.
+ *
+ * @param argc The number of command line arguments passed to the program.
+ * @param argv Array of command line arguments.
+ * @return int Exit status code; 0 indicates success; 1 indictates an error.
+ */
+int main(int argc, char *argv[]) {
+    const char *outputName = NULL;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = processors > 0 ? processors : 1;
+    int first = 1;
+
+    if (argc == 1) {
+        runInteractiveMatrix();
+        return 0;
+    }
+
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0 && atoi(argv[2]) > 0) {
+        benchmarkRenderers(atoi(argv[2]));
+        return 0;
+    }
+    for (; first + 1 < argc; first += 2) {
+        if (strcmp(argv[first], "--output") == 0) {
+            outputName = argv[first + 1];
+        } else if (strcmp(argv[first], "--threads") == 0) {
+            threads = atoi(argv[first + 1]);
+        } else {
+            break;
+        }
+    }
+    if (argc - first != 3 || atoi(argv[first]) <= 0 || strlen(argv[first + 1]) != 1 ||
+        !isMatrixShape(argv[first + 2]) || threads < 1) {
+        fprintf(stderr, "Usage: ./Matrix                        Ask for matrices until Ctrl-C\n"
+                        "       ./Matrix SIZE SYMBOL SHAPE      Print one matrix\n"
+                        "       ./Matrix --output FILE [--threads N] SIZE SYMBOL SHAPE\n"
+                        "                                       Render one matrix into FILE on N threads\n"
+                        "                                       (default: one per CPU)\n"
+                        "       ./Matrix --bench SIZE           Compare the renderers\n"
+                        "SHAPE is staircase, pyramid or diamond.\n");
+        exit(1);
+    }
+
+    if (outputName != NULL) {
+        renderMatrixFile(outputName, argv[first + 2], atoi(argv[first]), argv[first + 1][0], threads);
+        return 0;
+    }
+    // A failed fwrite of a large block only sets the error indicator, and a
+    // later fflush can still succeed, so both are checked
+    renderMatrix(stdout, argv[first + 2], atoi(argv[first]), argv[first + 1][0]);
+    if (fflush(stdout) != 0 || ferror(stdout)) {
+        fprintf(stderr, "Warning: Terminating program (could not write the matrix).\n");
+        exit(1);
+    }
+    return 0;
+}
+
+/**
+ * @brief Asks for a matrix size, symbol and shape, prints the matrix, and repeats.
+ */
+void runInteractiveMatrix(void) {
     // Input variables
     int matrix_size;
-    char matrix_symbol[2]; 
+    char matrix_symbol[2];
     char matrix_shape[15];
 
-    // Counting loop variables
-    int i, j; 
-
     // Infinite loop checking for valid input
     for(;;){
         for(;;){
@@ -41,79 +164,435 @@ int main() {
                 " you may choose from are:\n- staircase\n- pyramid\n- diamond\n"
             );
             printf(
-                "Please enter a positive integer value, a single character symbol," 
+                "Please enter a positive integer value, a single character symbol,"
                 " and a shape, seperated by spaces.\n"
-            ); 
+            );
 
-            scanf("%d %s %15s", &matrix_size, matrix_symbol, matrix_shape);      
+            scanf("%d %s %15s", &matrix_size, matrix_symbol, matrix_shape);
             printf("\n");
 
                 // Check user input for positive matrix size, single character symbol
                 // and that shape is a pre-defined option
-                if(matrix_size > 0 && 
-                   matrix_symbol[1] == '\0' && 
-                   (strcmp(matrix_shape, STAIRCASE) == 0 || 
-                    strcmp(matrix_shape, PYRAMID) == 0 ||
-                    strcmp(matrix_shape, DIAMOND) == 0)) {
+                if(matrix_size > 0 &&
+                   matrix_symbol[1] == '\0' &&
+                   isMatrixShape(matrix_shape)) {
                 break;
                 } else {
                     puts("Please ensure these input criteria are met: \n"
                         "- Matrix Shape is 'staircase', 'pyramid', or 'diamond'.\n"
                         "- Matrix Size is a positive integer.\n"
-                        "- Matrix Symbol is one character."); 
+                        "- Matrix Symbol is one character.");
                 }
         }
 
-        // If loop to print pyramid matrix
-        if(strcmp(matrix_shape, PYRAMID) == 0){ 
-            for(i = 1; i <= matrix_size; i++){ 
-                // Prints leading spaces to center symbols
-                for(j = matrix_size; j > i; j--){ 
-                    printf(" ");                
-                }
-                // Print symbols for the current row
-                for(j = 1; j <=(2 * i - 1); j++){ 
-                    printf("%c", matrix_symbol[0]); 
-                }          
-                printf("\n");
+        renderMatrix(stdout, matrix_shape, matrix_size, matrix_symbol[0]);
+    }
+}
+
+/**
+ * @brief Tells whether a name is one of the matrix shapes.
+ *
+ * @param shape The name to check.
+ * @return int 1 for staircase, pyramid or diamond; 0 otherwise.
+ */
+int isMatrixShape(const char *shape) {
+    return strcmp(shape, STAIRCASE) == 0 || strcmp(shape, PYRAMID) == 0 || strcmp(shape, DIAMOND) == 0;
+}
+
+/**
+ * @brief Prints a matrix, one block of rows at a time.
+ *
+ * Row i of a pyramid is size - i spaces followed by 2i - 1 symbols, so every
+ * row is the slice of the template row (size - 1 spaces, then 2 * size - 1
+ * symbols) that starts at i - 1 and holds size + i - 1 characters. A staircase
+ * row is the first i symbols of the template's symbols. The template is built
+ * once with memset, and the bottom half of a diamond takes the same slices as
+ * its top half in reverse, so no row is ever built twice. The output is the
+ * same as renderMatrixLegacy's, byte for byte.
+ *
+ * @param outputFile Where the matrix is written.
+ * @param shape staircase, pyramid or diamond.
+ * @param size The number of rows of the matrix, or of the top half of a diamond.
+ * @param symbol The character the matrix is drawn with.
+ */
+void renderMatrix(FILE *outputFile, const char *shape, int size, char symbol) {
+    MatrixWriter writer = { outputFile, malloc(MATRIX_BLOCK_SIZE), 0 };
+    char *template = malloc(3 * (size_t)size);
+    int i;
+
+    if (writer.block == NULL || template == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    memset(template, ' ', size - 1);
+    memset(template + size - 1, symbol, 2 * (size_t)size - 1);
+
+    if (strcmp(shape, STAIRCASE) == 0) {
+        for (i = 1; i <= size; i++) {
+            writeMatrixRow(&writer, template + size - 1, i);
+        }
+    } else {
+        for (i = 1; i <= size; i++) {
+            writeMatrixRow(&writer, template + i - 1, (size_t)size + i - 1);
+        }
+        if (strcmp(shape, DIAMOND) == 0) {
+            for (i = size - 1; i >= 1; i--) {
+                writeMatrixRow(&writer, template + i - 1, (size_t)size + i - 1);
             }
         }
-        // If loop to print staircase matrix
-        else if(strcmp(matrix_shape, STAIRCASE) == 0){
-            for(i = 1; i <= matrix_size; i++){
-                // Print symbols for the current row
-                for(j = 1; j <= i; j++){
-                    printf("%c", matrix_symbol[0]);
-                }
-                printf("\n");
+    }
+
+    flushMatrixRows(&writer);
+    free(writer.block);
+    free(template);
+}
+
+/**
+ * @brief Adds one row and its newline to the block, writing the block out when full.
+ *
+ * @param writer The matrix writer.
+ * @param row The characters of the row.
+ * @param length The number of characters, without the newline.
+ */
+void writeMatrixRow(MatrixWriter *writer, const char *row, size_t length) {
+    if (writer->used + length + 1 > MATRIX_BLOCK_SIZE) {
+        flushMatrixRows(writer);
+
+        // A row longer than the block is written straight from the template
+        if (length + 1 > MATRIX_BLOCK_SIZE) {
+            fwrite(row, 1, length, writer->outputFile);
+            fputc('\n', writer->outputFile);
+            return;
+        }
+    }
+    memcpy(writer->block + writer->used, row, length);
+    writer->block[writer->used + length] = '\n';
+    writer->used += length + 1;
+}
+
+/**
+ * @brief Writes out the rows gathered in the block.
+ *
+ * @param writer The matrix writer.
+ */
+void flushMatrixRows(MatrixWriter *writer) {
+    fwrite(writer->block, 1, writer->used, writer->outputFile);
+    writer->used = 0;
+}
+
+/**
+ * @brief Prints a matrix one character at a time, as the program first did.
+ *
+ * Kept as the reference that --bench times renderMatrix against.
+ *
+ * @param outputFile Where the matrix is written.
+ * @param shape staircase, pyramid or diamond.
+ * @param size The number of rows of the matrix, or of the top half of a diamond.
+ * @param symbol The character the matrix is drawn with.
+ */
+void renderMatrixLegacy(FILE *outputFile, const char *shape, int size, char symbol) {
+    // Counting loop variables
+    int i, j;
+
+    // If loop to print pyramid matrix
+    if(strcmp(shape, PYRAMID) == 0){
+        for(i = 1; i <= size; i++){
+            // Prints leading spaces to center symbols
+            for(j = size; j > i; j--){
+                fprintf(outputFile, " ");
+            }
+            // Print symbols for the current row
+            for(j = 1; j <=(2 * i - 1); j++){
+                fprintf(outputFile, "%c", symbol);
             }
+            fprintf(outputFile, "\n");
         }
-        // If loop to print diamond matrix
-        else if(strcmp(matrix_shape, DIAMOND) == 0){
-            // First loop to print top half of the diamond matrix
-            for(i = 1; i <= matrix_size; i++){
-                // Prints leading spaces to center symbols
-                for(j = matrix_size; j > i; j--){
-                    printf(" ");
-                }
-                // Print symbols for the current row
-                for(j = 1; j <= (2 * i - 1); j++){
-                    printf("%c", matrix_symbol[0]);
-                }             
-                printf("\n");
+    }
+    // If loop to print staircase matrix
+    else if(strcmp(shape, STAIRCASE) == 0){
+        for(i = 1; i <= size; i++){
+            // Print symbols for the current row
+            for(j = 1; j <= i; j++){
+                fprintf(outputFile, "%c", symbol);
             }
-            // Second loop to print the bottom half of the diamond matrix
-            for(i = matrix_size - 1; i >= 1; i--){
-                // Prints leading spaces to center symbols
-                for(j = matrix_size; j > i; j--){
-                    printf(" ");
-                }
-                // Print symbols for the current row
-                for(j = 1; j <= (2 * i - 1); j++){
-                    printf("%c", matrix_symbol[0]);
-                }
-                printf("\n");
+            fprintf(outputFile, "\n");
+        }
+    }
+    // If loop to print diamond matrix
+    else if(strcmp(shape, DIAMOND) == 0){
+        // First loop to print top half of the diamond matrix
+        for(i = 1; i <= size; i++){
+            // Prints leading spaces to center symbols
+            for(j = size; j > i; j--){
+                fprintf(outputFile, " ");
+            }
+            // Print symbols for the current row
+            for(j = 1; j <= (2 * i - 1); j++){
+                fprintf(outputFile, "%c", symbol);
             }
-        }   
+            fprintf(outputFile, "\n");
+        }
+        // Second loop to print the bottom half of the diamond matrix
+        for(i = size - 1; i >= 1; i--){
+            // Prints leading spaces to center symbols
+            for(j = size; j > i; j--){
+                fprintf(outputFile, " ");
+            }
+            // Print symbols for the current row
+            for(j = 1; j <= (2 * i - 1); j++){
+                fprintf(outputFile, "%c", symbol);
+            }
+            fprintf(outputFile, "\n");
+        }
+    }
+}
+
+/**
+ * @brief Gives the number of characters in a matrix, newlines included.
+ *
+ * @param shape staircase, pyramid or diamond.
+ * @param size The number of rows of the matrix, or of the top half of a diamond.
+ * @return size_t The number of characters.
+ */
+size_t matrixSize(const char *shape, int size) {
+    return matrixRowOffset(shape, size, matrixRowCount(shape, size));
+}
+
+/**
+ * @brief Gives the number of rows in a matrix.
+ *
+ * @param shape staircase, pyramid or diamond.
+ * @param size The number of rows of the matrix, or of the top half of a diamond.
+ * @return long The number of rows.
+ */
+long matrixRowCount(const char *shape, int size) {
+    return strcmp(shape, DIAMOND) == 0 ? 2L * size - 1 : size;
+}
+
+/**
+ * @brief Gives the number of characters before a row of a matrix, newlines included.
+ *
+ * Row r of a staircase holds r + 2 characters, so r * (r + 3) / 2 come before
+ * it. Row r of a pyramid holds size + r + 1, so r * size + r * (r + 1) / 2 come
+ * before it. The bottom half of a diamond follows a whole pyramid, and its
+ * row k holds 2 * size - 1 - k characters.
+ *
+ * @param shape staircase, pyramid or diamond.
+ * @param size The number of rows of the matrix, or of the top half of a diamond.
+ * @param row The row, from 0; the row count gives the size of the matrix.
+ * @return size_t The offset of the row.
+ */
+size_t matrixRowOffset(const char *shape, int size, long row) {
+    size_t rows = size;
+    size_t r = row;
+
+    if (strcmp(shape, STAIRCASE) == 0) {
+        return r * (r + 3) / 2;
+    }
+    if (r <= rows) {
+        return r * rows + r * (r + 1) / 2;
+    }
+    size_t k = r - rows;
+    return rows * rows + rows * (rows + 1) / 2 + k * (2 * rows - 1) - k * (k - 1) / 2;
+}
+
+/**
+ * @brief Gives the leading spaces and the symbols in a row of a matrix.
+ *
+ * @param shape staircase, pyramid or diamond.
+ * @param size The number of rows of the matrix, or of the top half of a diamond.
+ * @param row The row, from 0.
+ * @param spaces Receives the number of spaces before the symbols.
+ * @param symbols Receives the number of symbols.
+ */
+void matrixRowLayout(const char *shape, int size, long row, size_t *spaces, size_t *symbols) {
+    // i is the row of the pyramid that this row matches, from 1
+    long i = row < size ? row + 1 : 2L * size - 1 - row;
+
+    if (strcmp(shape, STAIRCASE) == 0) {
+        *spaces = 0;
+        *symbols = row + 1;
+    } else {
+        *spaces = size - i;
+        *symbols = 2 * i - 1;
+    }
+}
+
+/**
+ * @brief Renders a matrix straight into a file, on several threads.
+ *
+ * The file is sized to matrixSize, preallocated and mapped. The threads then
+ * claim MATRIX_ROW_CHUNK rows at a time and fill them in place at the offsets
+ * given by matrixRowOffset, so no thread waits for another and no byte passes
+ * through stdio. The file is the same as the one renderMatrix would write.
+ *
+ * @param outputName The file to write.
+ * @param shape staircase, pyramid or diamond.
+ * @param size The number of rows of the matrix, or of the top half of a diamond.
+ * @param symbol The character the matrix is drawn with.
+ * @param threads The number of threads to use.
+ */
+void renderMatrixFile(const char *outputName, const char *shape, int size, char symbol, int threads) {
+    MatrixFileJob job = {0};
+    size_t characters = matrixSize(shape, size);
+    long chunks;
+
+    job.shape = shape;
+    job.size = size;
+    job.symbol = symbol;
+    job.rows = matrixRowCount(shape, size);
+    chunks = (job.rows + MATRIX_ROW_CHUNK - 1) / MATRIX_ROW_CHUNK;
+
+    int fd = open(outputName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, characters) != 0) {
+        fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", outputName);
+        exit(1);
+    }
+    // Reserve the blocks now, so a full disk is reported here rather than as
+    // a fault while a thread writes the mapping; file systems that cannot
+    // preallocate are written as they are
+    if (posix_fallocate(fd, 0, characters) == ENOSPC) {
+        fprintf(stderr, "Warning: Terminating program (not enough space for '%s').\n", outputName);
+        exit(1);
+    }
+    job.output = mmap(NULL, characters, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (job.output == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map file '%s'.\n", outputName);
+        exit(1);
+    }
+
+    double start = currentSeconds();
+    if (threads > chunks) {
+        threads = chunks;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    if (threads <= 1) {
+        fillMatrixRows(&job);
+    } else {
+        pthread_t *workers = malloc(threads * sizeof(*workers));
+        if (workers == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+            exit(1);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_create(&workers[i], NULL, fillMatrixRows, &job);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
     }
-} // End of main
\ No newline at end of file
+    pthread_mutex_destroy(&job.lock);
+
+    if (munmap(job.output, characters) != 0 || close(fd) != 0) {
+        fprintf(stderr, "Warning: Terminating program (could not write the matrix).\n");
+        exit(1);
+    }
+    double elapsed = currentSeconds() - start;
+
+    printf("Rendered a %s of size %d into '%s' (%zu bytes).\n", shape, size, outputName, characters);
+    fprintf(stderr, "%zu chars in %.3f s on %d threads (%.1f M chars/s)\n", characters, elapsed,
+            threads > 1 ? threads : 1, characters / elapsed / 1e6);
+}
+
+/**
+ * @brief Thread of renderMatrixFile; fills chunks of rows until none are left.
+ *
+ * @param arg The MatrixFileJob shared by the threads.
+ * @return void* Always NULL.
+ */
+void *fillMatrixRows(void *arg) {
+    MatrixFileJob *job = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        long chunk = job->nextChunk++;
+        pthread_mutex_unlock(&job->lock);
+
+        long first = chunk * MATRIX_ROW_CHUNK;
+        if (first >= job->rows) {
+            return NULL;
+        }
+        long last = job->rows - first < MATRIX_ROW_CHUNK ? job->rows : first + MATRIX_ROW_CHUNK;
+        char *row = job->output + matrixRowOffset(job->shape, job->size, first);
+
+        for (long r = first; r < last; r++) {
+            size_t spaces, symbols;
+
+            matrixRowLayout(job->shape, job->size, r, &spaces, &symbols);
+            memset(row, ' ', spaces);
+            memset(row + spaces, job->symbol, symbols);
+            row[spaces + symbols] = '\n';
+            row += spaces + symbols + 1;
+        }
+    }
+}
+
+/**
+ * @brief Times renderMatrix against renderMatrixLegacy for each shape.
+ *
+ * Both renderers write to /dev/null, so the times do not include a terminal
+ * or disk. When the matrix is at most BENCH_VERIFY_LIMIT characters, both
+ * are also rendered into memory and compared byte for byte.
+ *
+ * @param size The size of the matrices.
+ */
+void benchmarkRenderers(int size) {
+    const char *shapes[] = { STAIRCASE, PYRAMID, DIAMOND };
+    FILE *nullFile = fopen("/dev/null", "w");
+
+    if (nullFile == NULL) {
+        fprintf(stderr, "Error: Could not open file '/dev/null'.\n");
+        exit(1);
+    }
+
+    printf("Renderer benchmark: size %d\n", size);
+    for (int i = 0; i < 3; i++) {
+        size_t characters = matrixSize(shapes[i], size);
+        const char *check = "not checked";
+        double start, legacySeconds, blockSeconds;
+
+        start = currentSeconds();
+        renderMatrixLegacy(nullFile, shapes[i], size, '#');
+        fflush(nullFile);
+        legacySeconds = currentSeconds() - start;
+
+        start = currentSeconds();
+        renderMatrix(nullFile, shapes[i], size, '#');
+        fflush(nullFile);
+        blockSeconds = currentSeconds() - start;
+
+        if (characters <= BENCH_VERIFY_LIMIT) {
+            char *legacyText = NULL, *blockText = NULL;
+            size_t legacyLength = 0, blockLength = 0;
+            FILE *legacyFile = open_memstream(&legacyText, &legacyLength);
+            FILE *blockFile = open_memstream(&blockText, &blockLength);
+
+            renderMatrixLegacy(legacyFile, shapes[i], size, '#');
+            renderMatrix(blockFile, shapes[i], size, '#');
+            fclose(legacyFile);
+            fclose(blockFile);
+            check = legacyLength == blockLength && legacyLength == characters &&
+                    memcmp(legacyText, blockText, legacyLength) == 0 ? "identical" : "DIFFERENT";
+            free(legacyText);
+            free(blockText);
+        }
+
+        printf("  %-10s %14zu chars  printf %9.3f s %10.1f M chars/s  block %9.3f s %10.1f M chars/s  %6.1fx  %s\n",
+               shapes[i], characters, legacySeconds, characters / legacySeconds / 1e6, blockSeconds,
+               characters / blockSeconds / 1e6, legacySeconds / blockSeconds, check);
+    }
+    fclose(nullFile);
+}
+
+/**
+ * @brief Returns a monotonic clock reading in seconds, for timing.
+ *
+ * @return double The current time in seconds.
+ */
+double currentSeconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
@@ -0,0 +1,687 @@
+/**
+ * @file decompress.c
+ * @author Dylan Baker
+ *
+ * @brief Transparent Decompression
+ * This module lets fileEcho.c and formattedInput.c read gzip and zstd files as
+ * if they were plain text. A compressed file is memory-mapped and decoded on a
+ * background thread, which writes the plain text into a pipe; the program reads
+ * the other end of the pipe like any other input, and never needs a temporary
+ * file. Where the format splits the data into pieces that can be decoded on
+ * their own, the pieces are decoded on a pool of threads and written in order:
+ * the blocks of BGZF files (gzip written by bgzip) and the frames of zstd files
+ * with more than one frame (written by pzstd or by concatenating files). Other
+ * gzip files, including ones of several members, are decoded as one stream.
+ *
+ * gzip support needs zlib (link with -lz), and zstd support needs libzstd (link
+ * with -lzstd). Either is left out when its header is not installed.
+ *
+ * @version 0.1
+ * @date 2024-11-23
+ * @copyright Copyright (c) 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "decompress.h"
+
+#if defined(__has_include)
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define HAVE_ZLIB
+#endif
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define HAVE_ZSTD
+#endif
+#else
+#include <zlib.h>
+#define HAVE_ZLIB
+#endif
+
+#define DECOMPRESS_BUFFER_SIZE (1 << 20) // Plain text written to the pipe at once by the stream decoders
+#define DECOMPRESS_WINDOW 4             // Decoded pieces held per thread, waiting to be written in order
+#define BGZF_GROUP_BLOCKS 64            // BGZF blocks decoded together, up to 4 MiB of text
+#define FRAME_SIZE_LIMIT (64 << 20)     // Largest zstd frame decoded whole on one thread
+#define ZLIB_INPUT_LIMIT (1U << 30)     // Most compressed bytes handed to zlib at once
+
+/**
+ * @brief A compressed file being decoded into a pipe.
+ *
+ * When the file can be split, it is split into units, each decoded on its own
+ * by a pool of workers. The thread that owns the job writes the units to the
+ * pipe in order, and only a window of decoded units is held at once.
+ */
+typedef struct {
+    char *fileName;             // Name of the file, for messages
+    const unsigned char *data;  // The compressed file, memory-mapped
+    size_t size;                // Bytes in the compressed file
+    int format;                 // COMPRESSION_GZIP or COMPRESSION_ZSTD
+    int outputFd;               // Write end of the pipe
+    int threads;                // Most threads decoding units at once
+    int writeFailed;            // Set when the reader has closed the pipe
+    size_t *unitStarts;         // Offset of each unit in the file, and the end of the last
+    size_t *unitSizes;          // Bytes of text each unit decodes to
+    size_t unitCount;           // Number of units, or 0 if the file is decoded as one stream
+    size_t nextUnit;            // Next unit for a worker to decode
+    size_t writtenUnits;        // Units already written to the pipe
+    size_t window;              // Number of decoded units held at once
+    unsigned char **outputs;    // Text of each unit in the window, or NULL if it failed
+    char *ready;                // Set when a unit has been decoded
+    int stopped;                // Set to make the workers stop early
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} DecompressJob;
+
+// Declaration of functions
+void *decompressFile(void *arg);
+int writeDecompressed(DecompressJob *job, const void *data, size_t length);
+int findBgzfUnits(DecompressJob *job);
+int findZstdUnits(DecompressJob *job);
+int addDecompressUnit(DecompressJob *job, size_t start, size_t textSize, size_t *capacity);
+int decompressUnits(DecompressJob *job);
+void *decodeUnits(void *arg);
+int decodeBgzfUnit(const unsigned char *data, size_t length, unsigned char *text, size_t textSize);
+int inflateStream(DecompressJob *job);
+int zstdStream(DecompressJob *job);
+
+/**
+ * @brief Tells whether a file is compressed, from its first bytes.
+ *
+ * The bytes are read with pread, so the file offset does not move. Anything
+ * that cannot be read that way, like a pipe, counts as not compressed.
+ *
+ * @param fd The open file.
+ * @return int COMPRESSION_NONE, COMPRESSION_GZIP or COMPRESSION_ZSTD.
+ */
+int detectCompression(int fd) {
+    unsigned char magic[4];
+
+    if (pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic)) {
+        return COMPRESSION_NONE;
+    }
+    if (magic[0] == 0x1f && magic[1] == 0x8b) {
+        return COMPRESSION_GZIP;
+    }
+    if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+/**
+ * @brief Returns a descriptor that reads the plain text of a file.
+ *
+ * A file that is not compressed is returned as it is. A compressed one is
+ * memory-mapped and decoded into a pipe on a background thread, and the read
+ * end of the pipe is returned; the caller still owns fd and may close it. If
+ * the data turns out to be corrupt, a warning is printed and the text ends
+ * where the damage starts.
+ *
+ * @param fd The open file.
+ * @param fileName The name of the file, for messages.
+ * @param threads Most threads to decode the file on.
+ * @return int A descriptor to read the text from, or -1 if the file cannot be decoded.
+ */
+int openDecompressed(int fd, const char *fileName, int threads) {
+    int format = detectCompression(fd);
+    struct stat info;
+    int pipeFds[2];
+
+    if (format == COMPRESSION_NONE) {
+        return fd;
+    }
+#ifndef HAVE_ZLIB
+    if (format == COMPRESSION_GZIP) {
+        fprintf(stderr, "Error: Could not decompress '%s' (built without gzip support).\n", fileName);
+        return -1;
+    }
+#endif
+#ifndef HAVE_ZSTD
+    if (format == COMPRESSION_ZSTD) {
+        fprintf(stderr, "Error: Could not decompress '%s' (built without zstd support).\n", fileName);
+        return -1;
+    }
+#endif
+
+    DecompressJob *job = calloc(1, sizeof(*job));
+    if (job == NULL || fstat(fd, &info) != 0 || pipe(pipeFds) != 0) {
+        fprintf(stderr, "Error: Could not decompress '%s'.\n", fileName);
+        free(job);
+        return -1;
+    }
+    job->size = info.st_size;
+    job->data = mmap(NULL, job->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    job->fileName = strdup(fileName);
+    if (job->data == MAP_FAILED || job->fileName == NULL) {
+        fprintf(stderr, "Error: Could not map file '%s'.\n", fileName);
+        if (job->data != MAP_FAILED) {
+            munmap((void *)job->data, job->size);
+        }
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        free(job->fileName);
+        free(job);
+        return -1;
+    }
+    posix_madvise((void *)job->data, job->size, POSIX_MADV_SEQUENTIAL);
+    job->format = format;
+    job->outputFd = pipeFds[1];
+    job->threads = threads > 0 ? threads : 1;
+
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attributes, decompressFile, job) != 0) {
+        fprintf(stderr, "Warning: Terminating program (could not start a thread).\n");
+        exit(1);
+    }
+    pthread_attr_destroy(&attributes);
+    return pipeFds[0];
+}
+
+/**
+ * @brief Background thread that decodes a compressed file into its pipe.
+ *
+ * The pipe is closed when the file ends, when the data is corrupt, or when
+ * the reader closes its end, and the job is freed.
+ *
+ * @param arg The DecompressJob of the file.
+ * @return void* Always NULL.
+ */
+void *decompressFile(void *arg) {
+    DecompressJob *job = arg;
+    sigset_t signals;
+    int decoded;
+
+    // A closed pipe shows up as EPIPE from write instead of ending the program
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    if (job->format == COMPRESSION_GZIP) {
+        decoded = findBgzfUnits(job) ? decompressUnits(job) : inflateStream(job);
+    } else {
+        decoded = findZstdUnits(job) ? decompressUnits(job) : zstdStream(job);
+    }
+    if (!decoded && !job->writeFailed) {
+        fprintf(stderr, "Warning: Could not decompress '%s' (corrupt or truncated data).\n", job->fileName);
+    }
+
+    close(job->outputFd);
+    munmap((void *)job->data, job->size);
+    free(job->unitStarts);
+    free(job->unitSizes);
+    free(job->fileName);
+    free(job);
+    return NULL;
+}
+
+/**
+ * @brief Writes decoded text to the pipe.
+ *
+ * @param job The file being decoded.
+ * @param data The text.
+ * @param length The number of bytes of text.
+ * @return int 0 on success, -1 if the reader has closed the pipe or a write failed.
+ */
+int writeDecompressed(DecompressJob *job, const void *data, size_t length) {
+    const char *next = data;
+
+    while (length > 0) {
+        ssize_t written = write(job->outputFd, next, length);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            job->writeFailed = 1;
+            return -1;
+        }
+        next += written;
+        length -= written;
+    }
+    return 0;
+}
+
+/**
+ * @brief Splits a BGZF file into units of whole blocks.
+ *
+ * A BGZF file is a series of gzip members of at most 64 KiB, each holding its
+ * own compressed size in a BC extra field and its text size in its trailer,
+ * so the blocks can be found without decoding them.
+ *
+ * @param job The file being decoded; its units are set.
+ * @return int 1 if the whole file is made of BGZF blocks, 0 otherwise.
+ */
+int findBgzfUnits(DecompressJob *job) {
+#ifdef HAVE_ZLIB
+    const unsigned char *data = job->data;
+    size_t capacity = 0;
+    size_t position = 0;
+    size_t blocks = 0;
+    size_t unitText = 0;
+
+    while (position < job->size) {
+        const unsigned char *block = data + position;
+        size_t blockSize = 0;
+
+        // A gzip header with the FEXTRA flag and room for its extra field
+        if (job->size - position < 18 || block[0] != 0x1f || block[1] != 0x8b || block[2] != 8 ||
+            !(block[3] & 4)) {
+            break;
+        }
+        size_t extraLength = block[10] | (size_t)block[11] << 8;
+        if (12 + extraLength > job->size - position) {
+            break;
+        }
+
+        // Find the BC subfield, which holds the block size less one
+        for (size_t field = 12; field + 4 <= 12 + extraLength; ) {
+            size_t fieldLength = block[field + 2] | (size_t)block[field + 3] << 8;
+
+            if (block[field] == 'B' && block[field + 1] == 'C' && fieldLength == 2 && field + 6 <= 12 + extraLength) {
+                blockSize = (block[field + 4] | (size_t)block[field + 5] << 8) + 1;
+                break;
+            }
+            field += 4 + fieldLength;
+        }
+        if (blockSize < 12 + extraLength + 8 || blockSize > job->size - position) {
+            break;
+        }
+
+        if (blocks % BGZF_GROUP_BLOCKS == 0) {
+            if (blocks > 0) {
+                job->unitSizes[job->unitCount - 1] = unitText;
+            }
+            if (addDecompressUnit(job, position, 0, &capacity) != 0) {
+                break;
+            }
+            unitText = 0;
+        }
+        const unsigned char *trailer = block + blockSize - 4;
+        unitText += trailer[0] | (size_t)trailer[1] << 8 | (size_t)trailer[2] << 16 | (size_t)trailer[3] << 24;
+        position += blockSize;
+        blocks++;
+    }
+
+    if (position != job->size || blocks == 0) {
+        job->unitCount = 0;
+        return 0;
+    }
+    job->unitSizes[job->unitCount - 1] = unitText;
+    job->unitStarts[job->unitCount] = job->size;
+    return 1;
+#else
+    (void)job;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Splits a zstd file into units of one frame each.
+ *
+ * Frames are only decoded apart when there is more than one and each records
+ * a text size small enough to decode whole; otherwise the file is decoded as
+ * one stream, which holds less in memory.
+ *
+ * @param job The file being decoded; its units are set.
+ * @return int 1 if the file was split, 0 otherwise.
+ */
+int findZstdUnits(DecompressJob *job) {
+#ifdef HAVE_ZSTD
+    size_t capacity = 0;
+    size_t position = 0;
+
+    while (position < job->size) {
+        size_t frameSize = ZSTD_findFrameCompressedSize(job->data + position, job->size - position);
+        unsigned long long textSize = ZSTD_getFrameContentSize(job->data + position, job->size - position);
+
+        if (ZSTD_isError(frameSize) || textSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+            textSize == ZSTD_CONTENTSIZE_ERROR || textSize > FRAME_SIZE_LIMIT ||
+            addDecompressUnit(job, position, textSize, &capacity) != 0) {
+            job->unitCount = 0;
+            return 0;
+        }
+        position += frameSize;
+    }
+    if (job->unitCount < 2) {
+        job->unitCount = 0;
+        return 0;
+    }
+    job->unitStarts[job->unitCount] = job->size;
+    return 1;
+#else
+    (void)job;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Adds a unit to the units of a file, growing the arrays as needed.
+ *
+ * One more start than units is kept room for, to hold the end of the last unit.
+ *
+ * @param job The file being decoded.
+ * @param start Offset of the unit in the file.
+ * @param textSize Bytes of text the unit decodes to.
+ * @param capacity Number of units the arrays have room for, updated when they grow.
+ * @return int 0 on success, -1 if out of memory.
+ */
+int addDecompressUnit(DecompressJob *job, size_t start, size_t textSize, size_t *capacity) {
+    if (job->unitCount + 1 >= *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 64;
+        size_t *starts = realloc(job->unitStarts, grown * sizeof(*starts));
+
+        if (starts == NULL) {
+            return -1;
+        }
+        job->unitStarts = starts;
+        size_t *sizes = realloc(job->unitSizes, grown * sizeof(*sizes));
+        if (sizes == NULL) {
+            return -1;
+        }
+        job->unitSizes = sizes;
+        *capacity = grown;
+    }
+    job->unitStarts[job->unitCount] = start;
+    job->unitSizes[job->unitCount++] = textSize;
+    return 0;
+}
+
+/**
+ * @brief Decodes the units of a file on a pool of workers and writes them in order.
+ *
+ * @param job The file being decoded, already split into units.
+ * @return int 1 if every unit was decoded and written, 0 otherwise.
+ */
+int decompressUnits(DecompressJob *job) {
+    size_t threadCount = (size_t)job->threads < job->unitCount ? (size_t)job->threads : job->unitCount;
+    int decoded = 1;
+
+    job->window = threadCount * DECOMPRESS_WINDOW;
+    job->outputs = calloc(job->window, sizeof(*job->outputs));
+    job->ready = calloc(job->window, 1);
+    pthread_t *threads = malloc(threadCount * sizeof(*threads));
+    if (job->outputs == NULL || job->ready == NULL || threads == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->changed, NULL);
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, decodeUnits, job);
+    }
+
+    // Write the units in order, stopping at the first that cannot be decoded or written
+    while (job->writtenUnits < job->unitCount) {
+        size_t slot = job->writtenUnits % job->window;
+
+        pthread_mutex_lock(&job->lock);
+        while (!job->ready[slot]) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        pthread_mutex_unlock(&job->lock);
+
+        unsigned char *text = job->outputs[slot];
+        if (text == NULL || writeDecompressed(job, text, job->unitSizes[job->writtenUnits]) != 0) {
+            decoded = 0;
+        }
+        free(text);
+
+        pthread_mutex_lock(&job->lock);
+        job->ready[slot] = 0;
+        job->outputs[slot] = NULL;
+        job->writtenUnits++;
+        if (!decoded) {
+            job->stopped = 1;
+        }
+        pthread_cond_broadcast(&job->changed);
+        pthread_mutex_unlock(&job->lock);
+        if (!decoded) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Units decoded ahead of a failure are never written
+    for (size_t i = 0; i < job->window; i++) {
+        free(job->outputs[i]);
+    }
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->changed);
+    free(threads);
+    free(job->outputs);
+    free(job->ready);
+    return decoded;
+}
+
+/**
+ * @brief Worker thread that decodes units of a file.
+ *
+ * A worker takes the next unit as long as it fits in the window of units that
+ * have not been written yet. A unit that cannot be decoded is marked ready with
+ * no text, and the writer stops there.
+ *
+ * @param arg The DecompressJob of the file.
+ * @return void* Always NULL.
+ */
+void *decodeUnits(void *arg) {
+    DecompressJob *job = arg;
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *context = job->format == COMPRESSION_ZSTD ? ZSTD_createDCtx() : NULL;
+#endif
+
+    pthread_mutex_lock(&job->lock);
+    while (1) {
+        while (!job->stopped && job->nextUnit < job->unitCount && job->nextUnit >= job->writtenUnits + job->window) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (job->stopped || job->nextUnit >= job->unitCount) {
+            break;
+        }
+        size_t unit = job->nextUnit++;
+        pthread_mutex_unlock(&job->lock);
+
+        const unsigned char *data = job->data + job->unitStarts[unit];
+        size_t length = job->unitStarts[unit + 1] - job->unitStarts[unit];
+        size_t textSize = job->unitSizes[unit];
+        unsigned char *text = malloc(textSize ? textSize : 1);
+        int decoded = 0;
+
+        if (text != NULL && job->format == COMPRESSION_GZIP) {
+            decoded = decodeBgzfUnit(data, length, text, textSize);
+        }
+#ifdef HAVE_ZSTD
+        if (text != NULL && context != NULL && job->format == COMPRESSION_ZSTD) {
+            size_t result = ZSTD_decompressDCtx(context, text, textSize, data, length);
+            decoded = !ZSTD_isError(result) && result == textSize;
+        }
+#endif
+        if (!decoded) {
+            free(text);
+            text = NULL;
+        }
+
+        pthread_mutex_lock(&job->lock);
+        job->outputs[unit % job->window] = text;
+        job->ready[unit % job->window] = 1;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(context);
+#endif
+    return NULL;
+}
+
+/**
+ * @brief Decodes a run of BGZF blocks and checks each against its trailer.
+ *
+ * @param data The first block.
+ * @param length Bytes in the run of blocks.
+ * @param text Receives the text of the blocks.
+ * @param textSize Bytes of text the blocks decode to.
+ * @return int 1 if every block decoded to the size and CRC-32 in its trailer, 0 otherwise.
+ */
+int decodeBgzfUnit(const unsigned char *data, size_t length, unsigned char *text, size_t textSize) {
+#ifdef HAVE_ZLIB
+    z_stream stream;
+    size_t position = 0;
+    size_t produced = 0;
+    int decoded = 1;
+
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -15) != Z_OK) {
+        return 0;
+    }
+
+    // The block sizes were checked when the units were found
+    while (decoded && position < length) {
+        const unsigned char *block = data + position;
+        size_t extraLength = block[10] | (size_t)block[11] << 8;
+        size_t blockSize = 0;
+
+        for (size_t field = 12; field + 4 <= 12 + extraLength; ) {
+            size_t fieldLength = block[field + 2] | (size_t)block[field + 3] << 8;
+
+            if (block[field] == 'B' && block[field + 1] == 'C' && fieldLength == 2) {
+                blockSize = (block[field + 4] | (size_t)block[field + 5] << 8) + 1;
+                break;
+            }
+            field += 4 + fieldLength;
+        }
+
+        const unsigned char *trailer = block + blockSize - 8;
+        unsigned long crc = trailer[0] | (unsigned long)trailer[1] << 8 | (unsigned long)trailer[2] << 16 |
+                            (unsigned long)trailer[3] << 24;
+        size_t blockText = trailer[4] | (size_t)trailer[5] << 8 | (size_t)trailer[6] << 16 | (size_t)trailer[7] << 24;
+
+        inflateReset(&stream);
+        stream.next_in = (unsigned char *)block + 12 + extraLength;
+        stream.avail_in = blockSize - 12 - extraLength - 8;
+        stream.next_out = text + produced;
+        stream.avail_out = blockText;
+        decoded = blockText <= textSize - produced && inflate(&stream, Z_FINISH) == Z_STREAM_END &&
+                  stream.total_out == blockText && crc32(0, text + produced, blockText) == crc;
+        produced += blockText;
+        position += blockSize;
+    }
+    inflateEnd(&stream);
+    return decoded && produced == textSize;
+#else
+    (void)data;
+    (void)length;
+    (void)text;
+    (void)textSize;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Decodes a gzip file of one or more members as one stream.
+ *
+ * @param job The file being decoded.
+ * @return int 1 if the whole file was decoded and written, 0 otherwise.
+ */
+int inflateStream(DecompressJob *job) {
+#ifdef HAVE_ZLIB
+    unsigned char *text = malloc(DECOMPRESS_BUFFER_SIZE);
+    size_t remaining = job->size;
+    z_stream stream;
+    int result = Z_OK;
+
+    memset(&stream, 0, sizeof(stream));
+    if (text == NULL || inflateInit2(&stream, 15 + 16) != Z_OK) {
+        free(text);
+        return 0;
+    }
+    stream.next_in = (unsigned char *)job->data;
+
+    while (1) {
+        // zlib counts input in unsigned ints, so hand it the file a piece at a time
+        if (stream.avail_in == 0 && remaining > 0) {
+            stream.avail_in = remaining < ZLIB_INPUT_LIMIT ? remaining : ZLIB_INPUT_LIMIT;
+            remaining -= stream.avail_in;
+        }
+        stream.next_out = text;
+        stream.avail_out = DECOMPRESS_BUFFER_SIZE;
+        result = inflate(&stream, Z_NO_FLUSH);
+
+        if (writeDecompressed(job, text, DECOMPRESS_BUFFER_SIZE - stream.avail_out) != 0) {
+            break;
+        }
+        if (result == Z_STREAM_END) {
+            // Another member may follow this one
+            if (stream.avail_in == 0 && remaining == 0) {
+                break;
+            }
+            inflateReset(&stream);
+            result = Z_OK;
+        } else if (result != Z_OK && !(result == Z_BUF_ERROR && stream.avail_in == 0 && remaining > 0)) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    free(text);
+    return result == Z_STREAM_END && !job->writeFailed;
+#else
+    (void)job;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Decodes a zstd file of one or more frames as one stream.
+ *
+ * @param job The file being decoded.
+ * @return int 1 if the whole file was decoded and written, 0 otherwise.
+ */
+int zstdStream(DecompressJob *job) {
+#ifdef HAVE_ZSTD
+    unsigned char *text = malloc(DECOMPRESS_BUFFER_SIZE);
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    ZSTD_inBuffer input = { job->data, job->size, 0 };
+    size_t result = 1;
+
+    if (text == NULL || stream == NULL) {
+        free(text);
+        ZSTD_freeDStream(stream);
+        return 0;
+    }
+    ZSTD_initDStream(stream);
+
+    // Keep going until the input is used up and the last frame is finished
+    while (input.pos < input.size || result != 0) {
+        ZSTD_outBuffer output = { text, DECOMPRESS_BUFFER_SIZE, 0 };
+        size_t before = input.pos;
+
+        result = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(result) || writeDecompressed(job, text, output.pos) != 0) {
+            break;
+        }
+        if (input.pos == input.size && before == input.pos && output.pos == 0 && result != 0) {
+            // The file ends inside a frame
+            break;
+        }
+    }
+    ZSTD_freeDStream(stream);
+    free(text);
+    return !ZSTD_isError(result) && result == 0 && input.pos == input.size && !job->writeFailed;
+#else
+    (void)job;
+    return 0;
+#endif
+}
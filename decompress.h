@@ -0,0 +1,26 @@
+/**
+ * @file decompress.h
+ * @author Dylan Baker
+ *
+ * @brief Transparent Decompression
+ * Detects gzip and zstd files by their magic bytes and decodes them on
+ * background threads into a pipe, so that programs reading plain text can
+ * read compressed files through the same descriptor-based code.
+ *
+ * @version 0.1
+ * @date 2024-11-23
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+// Kinds of file that detectCompression tells apart
+#define COMPRESSION_NONE 0
+#define COMPRESSION_GZIP 1
+#define COMPRESSION_ZSTD 2
+
+int detectCompression(int fd);
+int openDecompressed(int fd, const char *fileName, int threads);
+
+#endif
@@ -5,29 +5,229 @@
  * @brief File Echo
  * This program takes input from a file, or a list of files, and prints 
  * the data from each file, and each file named in a list of files,
- * to standard output.
+ * to standard output. Files compressed with gzip or zstd are decompressed as
+ * they are printed.
+ * 
+ * Build with: gcc -O2 -pthread -o fileEcho fileEcho.c decompress.c -lz
+ * (add -lzstd when libzstd is installed)
  * 
  * @version 0.1
  * @date 2024-11-23
  * @copyright Copyright (c) 2024
  */
 
+#define _GNU_SOURCE // For copy_file_range and splice
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include "decompress.h"
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
 
 #define SIZE 255 // Define buffer size for reading lines
+#define OUTPUT_BUFFER_SIZE (1 << 20) // Output collected before it is written
+#define OUTPUT_ALIGNMENT 4096       // Alignment of the output buffer, one page
+#define OUTPUT_VECTORS 1024         // Pieces of output written by one writev, at most IOV_MAX
+#define OUTPUT_COPY_LIMIT (64 << 10) // Larger pieces are written from where they are, not copied
+#define COPY_CHUNK_SIZE (1 << 30)   // Most bytes asked of one kernel copy call
+#define PREFETCH_THREADS 8          // Files of a list read at once, unless -j is given
+#define PREFETCH_MEMORY (64 << 20)  // Most bytes of a list held in memory at once
+#define FILTER_BUFFER_SIZE (1 << 22) // Input read at once by --match when a file cannot be mapped
+#define FOLLOW_EVENTS 4096          // Bytes of inotify events read at once
+#define FOLLOW_POLL_SECONDS 1       // Time between checks when inotify is not available
+
+// Ways of copying a file to standard output, fastest first
+#define COPY_FILE_RANGE 0           // copy_file_range, from a file to a file
+#define COPY_SPLICE 1               // splice, from a file to a pipe
+#define COPY_SENDFILE 2             // sendfile, from a file to anything else
+#define COPY_READ_WRITE 3           // read and write through a buffer
+
+// Results of copying a file
+#define COPY_OK 0
+#define COPY_READ_ERROR -1
+#define COPY_WRITE_ERROR -2
+
+// Results of reading a file from a list ahead of its turn
+#define PREFETCH_OK 0
+#define PREFETCH_OPEN_ERROR 1
+#define PREFETCH_READ_ERROR 2
+
+/**
+ * @brief A file from a file list, read ahead of its turn to be printed.
+ */
+typedef struct {
+    char *data;                 // Start of the file, read into memory
+    size_t length;              // Number of bytes in data
+    int fd;                     // Descriptor to copy the rest of the file from, or -1 if all was read
+    int status;                 // PREFETCH_OK, PREFETCH_OPEN_ERROR or PREFETCH_READ_ERROR
+    long reads;                 // read calls made by the worker
+} PrefetchedFile;
+
+/**
+ * @brief Work shared between the threads that read the files of a list ahead.
+ * 
+ * Workers read files into a window of slots, and the main thread prints the
+ * slots in list order. Each slot holds at most bufferLimit bytes, so a window
+ * never holds more than PREFETCH_MEMORY bytes; the rest of a larger file is
+ * copied straight from its descriptor when its turn comes.
+ */
+typedef struct {
+    char **names;               // Files in the order they are printed
+    size_t fileCount;           // Number of files in the list
+    size_t nextFile;            // Next file for a worker to read
+    size_t printedFiles;        // Files already printed
+    size_t window;              // Number of files held at once
+    size_t bufferLimit;         // Most bytes read ahead from one file
+    PrefetchedFile *files;      // Each file in the window
+    char *ready;                // Set when a file has been read
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} PrefetchJob;
+
+/**
+ * @brief Output collected in memory and written to a descriptor with writev.
+ * 
+ * Small pieces of output are copied into one page-aligned buffer. Large pieces,
+ * such as memory-mapped files, are only pointed to, so their bytes are never
+ * copied by this program. Both kinds are written together by one writev when
+ * the buffer or the list of pieces is full, or when the output is flushed.
+ */
+typedef struct {
+    int fd;                     // Descriptor the output goes to
+    char *buffer;               // Page-aligned buffer of OUTPUT_BUFFER_SIZE bytes
+    size_t used;                // Bytes of the buffer holding output
+    struct iovec pieces[OUTPUT_VECTORS]; // Output not written yet, in order
+    int pieceCount;             // Number of pieces
+    int kernelCopies;           // Cleared once the kernel cannot copy to fd
+} OutputWriter;
+
+/**
+ * @brief Counts of the work done to echo files, for --stats.
+ */
+typedef struct {
+    double bytes;               // Bytes written to standard output
+    double seconds;             // Wall time
+    long reads;                 // read calls
+    long writes;                // write and writev calls
+    long copies;                // copy_file_range, splice and sendfile calls
+    long maps;                  // mmap and munmap calls
+} EchoStats;
+
+/**
+ * @brief A file followed with -f.
+ */
+typedef struct {
+    char *name;                 // Name the file was given by, checked again after rotation
+    int fd;                     // The file being read
+    dev_t device;               // Device and inode of the file being read, to tell when
+    ino_t inode;                // the name has been given to a new file
+    off_t offset;               // Bytes of the file printed so far
+    int watch;                  // inotify watch of the file
+    int directoryWatch;         // inotify watch of the directory holding the name
+    char *pending;              // With --match, a last line still waiting for its newline
+    size_t pendingLength;       // Bytes in pending
+    size_t pendingCapacity;     // Bytes allocated for pending
+} FollowedFile;
+
+/**
+ * @brief Every file followed with -f, all watched by one inotify descriptor.
+ */
+typedef struct {
+    FollowedFile *files;        // The followed files
+    size_t fileCount;           // Number of followed files
+    size_t capacity;            // Number of files allocated
+    int inotifyFd;              // inotify descriptor, or -1 if checks are timed instead
+    long lastPrinted;           // File whose bytes were printed last, or -1
+} Follower;
+
+/**
+ * @brief A function that finds the first place a pattern occurs in some text.
+ */
+typedef const char *(*PatternSearch)(const char *text, size_t length, const char *pattern, size_t patternLength);
+
+int prefetchThreads = PREFETCH_THREADS; // Files of a list read at once, set with -j
+const char *matchPattern = NULL; // Lines must contain this to be printed, set with --match
+size_t matchLength = 0;         // Length of matchPattern
+int invertMatch = 0;            // Set by --invert to print the lines that do not match instead
+PatternSearch findPattern;      // Fastest pattern search this CPU supports
+int followMode = 0;             // Set by -f to follow the files that follow it
+Follower follower;              // Files followed with -f
+int showStats = 0;              // Set by --stats
+OutputWriter output;            // Standard output
+EchoStats counts;               // Work done so far by the main thread
+EchoStats fileStart;            // Counts when the current file started
+EchoStats totalStats;           // Work done for every file reported with --stats
+long statsFiles = 0;            // Number of files in totalStats
 
 FILE *openFile(char *fileName);
 void printFileContent(FILE *inputFile);
 void printFileFromList(FILE *inputFile);
+char **readFileList(FILE *inputFile, size_t *fileCount);
+void printPrefetchedFiles(char **names, size_t fileCount);
+void *prefetchFiles(void *arg);
+void readFileAhead(const char *fileName, PrefetchedFile *file, size_t bufferLimit);
+void printPrefetchedFile(PrefetchedFile *file, const char *fileName);
+int copyFileData(int inputFd, OutputWriter *writer);
+int chooseCopyMethod(const struct stat *input, const struct stat *output);
+ssize_t copyChunk(int method, int inputFd, int outputFd);
+int copyWithMap(int inputFd, const struct stat *input, OutputWriter *writer);
+int copyWithRead(int inputFd, OutputWriter *writer);
+void initOutput(OutputWriter *writer, int fd);
+int outputBytes(OutputWriter *writer, const char *data, size_t length);
+int outputMapped(OutputWriter *writer, const char *data, size_t length);
+void recordBuffered(OutputWriter *writer, size_t length);
+int flushOutput(OutputWriter *writer);
+double currentSeconds(void);
+void startFileStats(void);
+void reportFileStats(const char *fileName);
+void printStats(const char *label, const EchoStats *stats);
+int filterFileData(int inputFd, OutputWriter *writer);
+int filterWithRead(int inputFd, const char *data, size_t length, OutputWriter *writer);
+int filterLines(const char *data, size_t length, int final, OutputWriter *writer, size_t *consumed);
+PatternSearch selectPatternSearch(void);
+const char *findPatternScalar(const char *text, size_t length, const char *pattern, size_t patternLength);
+#ifdef HAVE_X86_KERNELS
+const char *findPatternSse2(const char *text, size_t length, const char *pattern, size_t patternLength);
+const char *findPatternAvx2(const char *text, size_t length, const char *pattern, size_t patternLength);
+#endif
+int followFile(Follower *follower, const char *fileName);
+int openFollowedFile(Follower *follower, FollowedFile *file);
+void watchFollowedFile(Follower *follower, FollowedFile *file);
+void printNewData(Follower *follower, size_t index);
+int filterNewData(FollowedFile *file);
+void checkRotation(Follower *follower, size_t index);
+void followFiles(Follower *follower);
 
 /**
  * @brief Main
  * 
  * Main processes command line arguments. If no files are specified, the user
  * receives a usage example. It prints the contents of individual files, or 
- * prints the content of files contained within a list of files.
+ * prints the content of files contained within a list of files. The option
+ * -j sets how many files of a list are read at once; it applies to the lists
+ * that follow it. The option --stats reports the bytes, time, throughput and
+ * system calls of each file that follows it, and of all of them, to stderr.
+ * The option --match PATTERN prints only the lines that contain PATTERN, and
+ * --invert only those that do not, giving the same output as piping the echo
+ * through grep -F (or grep -vF). The option -f follows the regular files that
+ * come after it: once every other argument has been handled, those files are
+ * printed, and then the bytes appended to them as they arrive, until the
+ * program is stopped.
  * 
  * @param argc Number of command line arguments.
  * @param argv Array of command line arguments.
@@ -36,13 +236,39 @@ void printFileFromList(FILE *inputFile);
 int main (int argc, char *argv[]) {
     // Check if no arguments were provided (other than program name).
     if(argc == 1){
-        printf("Usage: ./a.exe [-a file__list.txt] [file__.txt] [file__.txt]");
+        printf("Usage: ./a.exe [--stats] [-j threads] [--match pattern [--invert]] [-f] [-a file__list.txt] [file__.txt] [file__.txt]");
     }
+    initOutput(&output, STDOUT_FILENO);
+    findPattern = selectPatternSearch();
+    follower.inotifyFd = -1;
+    follower.lastPrinted = -1;
     
     // Loop to read files
     for(int i = 1; i < argc; i++){
-        // If argument is "-a", handle the file list case
-        if(strcmp(argv[i], "-a") == 0){
+        // If argument is "--stats", report the work done for the files that follow
+        if(strcmp(argv[i], "--stats") == 0){
+            showStats = 1;
+        } else if(strcmp(argv[i], "--invert") == 0){
+            invertMatch = 1;
+        } else if(strcmp(argv[i], "-f") == 0){
+            followMode = 1;
+        } else if(strcmp(argv[i], "--match") == 0){
+            // If argument is "--match", print only the matching lines of the files that follow
+            if(i + 1 >= argc || strchr(argv[i + 1], '\n') != NULL) {
+                fprintf(stderr, "Error: Missing pattern after --match, or pattern has a newline.\n");
+                continue;
+            }
+            matchPattern = argv[++i];
+            matchLength = strlen(matchPattern);
+        } else if(strcmp(argv[i], "-j") == 0){
+            // If argument is "-j", set the number of files of a list read at once
+            if(i + 1 >= argc || atoi(argv[i + 1]) < 1) {
+                fprintf(stderr, "Error: Missing number of threads after -j.\n");
+                continue;
+            }
+            prefetchThreads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-a") == 0){
+            // If argument is "-a", handle the file list case
             if(i + 1 >= argc) {
                 // Check for a file name after list call
                 fprintf(stderr, "Error: Missing file list name after -a.\n");
@@ -54,6 +280,7 @@ int main (int argc, char *argv[]) {
             FILE *inputFile = openFile(fileListName);
            
             if(!inputFile){
+                flushOutput(&output);
                 fprintf(stderr, "Error: Could not open file list '%s'.\n", fileListName);
                 continue;
             }
@@ -67,14 +294,33 @@ int main (int argc, char *argv[]) {
         FILE *inputFile = openFile(fileName);
         
         if(!inputFile){
+            flushOutput(&output);
             fprintf(stderr, "Error: Could not open file '%s'.\n", fileName);
             continue;
         }
+        if(followMode && followFile(&follower, fileName) == 0) {
+            fclose(inputFile);
+            continue;
+        }
         
+        startFileStats();
         printFileContent(inputFile);
         fclose(inputFile);
+        reportFileStats(fileName);
         }    
     }
+
+    flushOutput(&output);
+    if(follower.fileCount > 0) {
+        followFiles(&follower);
+    }
+    if(showStats) {
+        char label[64];
+
+        snprintf(label, sizeof(label), "Total (%ld files)", statsFiles);
+        printStats(label, &totalStats);
+    }
+    return 0;
 }
 
 /**
@@ -82,46 +328,791 @@ int main (int argc, char *argv[]) {
  * 
  * This function attempts to open a file specified by name.
  * It returns a file pointer if successful, or NULL if there is an error.
+ * A file compressed with gzip or zstd is decompressed on background threads,
+ * and the file pointer returned reads its text.
  * 
  * @param fileName Name of the file to open.
  * @return FILE* A pointer to the opened file, or NULL.
  */
 FILE *openFile(char *fileName) {
     FILE* file = fopen(fileName, "r");
+    if(file == NULL) {
+        return NULL;
+    }
+
+    int fd = openDecompressed(fileno(file), fileName, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    if(fd != fileno(file)) {
+        fclose(file);
+        file = fd >= 0 ? fdopen(fd, "r") : NULL;
+    }
     return file;
 }
 
 /**
  * @brief Prints the contents of a file.
  * 
- * This function reads the contents of a file line by line,
- * printing each line to standard output.
+ * This function copies the contents of a file to standard output byte for byte,
+ * NUL bytes included, followed by a newline. The copy goes through
+ * copyFileData rather than stdio, so anything already printed with stdio is
+ * flushed first. With --match, only the lines selected by filterFileData are
+ * printed.
  * 
  * @param inputFile A pointer to the file to read from.
  */
 void printFileContent(FILE *inputFile){
-    // Buffer to hold each line of the file
-    char buffer[SIZE];
-    
-    // Read and print each line of the file
-    while(fgets(buffer, SIZE, inputFile) != NULL) {
-        printf("%s", buffer);
+    fflush(stdout);
+
+    if(matchPattern != NULL) {
+        int result = filterFileData(fileno(inputFile), &output);
+        if(result == COPY_READ_ERROR) {
+            fprintf(stderr, "Error reading from file.\n");
+        } else if(result == COPY_WRITE_ERROR) {
+            fprintf(stderr, "Error writing to standard output.\n");
+        }
+        return;
+    }
+
+    int result = copyFileData(fileno(inputFile), &output);
+    if(result != COPY_OK) {
+        flushOutput(&output);
     }
-    if(ferror(inputFile)) {
+    if(result == COPY_READ_ERROR) {
         fprintf(stderr, "Error reading from file.\n");
+    } else if(result == COPY_WRITE_ERROR) {
+        fprintf(stderr, "Error writing to standard output.\n");
+    }
+    outputBytes(&output, "\n", 1);
+}
+
+/**
+ * @brief Copies everything left in a file descriptor to an output.
+ * 
+ * Where it can, the copy stays inside the kernel, so the bytes are never
+ * copied into this program: copy_file_range when the output is a regular file,
+ * splice when it is a pipe, and sendfile for anything else, such as a terminal.
+ * If the kernel cannot copy between the two descriptors, the copy carries on
+ * from where it stopped with the next way: a large regular file is memory-mapped
+ * and written from the mapping, and anything else is read into the output buffer.
+ * Every byte is copied as it is, including NUL bytes.
+ * 
+ * @param inputFd The descriptor to copy from, read from its current offset.
+ * @param writer The output to copy to; output collected before the copy goes first.
+ * @return int COPY_OK, COPY_READ_ERROR or COPY_WRITE_ERROR.
+ */
+int copyFileData(int inputFd, OutputWriter *writer) {
+    struct stat input, outputInfo;
+
+    if(fstat(inputFd, &input) != 0 || fstat(writer->fd, &outputInfo) != 0) {
+        return COPY_READ_ERROR;
+    }
+
+    int method = writer->kernelCopies ? chooseCopyMethod(&input, &outputInfo) : COPY_READ_WRITE;
+    if(method != COPY_READ_WRITE && flushOutput(writer) != 0) {
+        return COPY_WRITE_ERROR;
+    }
+    while(method != COPY_READ_WRITE) {
+        ssize_t copied = copyChunk(method, inputFd, writer->fd);
+
+        counts.copies++;
+        if(copied > 0) {
+            counts.bytes += copied;
+            continue;
+        }
+        if(copied < 0 && errno == EINTR) {
+            continue;
+        }
+        if(copied == 0) {
+            return COPY_OK;
+        }
+        if(errno == EPIPE) {
+            return COPY_WRITE_ERROR;
+        }
+        if(errno != EINVAL && errno != ENOSYS && errno != EXDEV && errno != EOPNOTSUPP &&
+           errno != EBADF && errno != EAGAIN) {
+            return COPY_READ_ERROR;
+        }
+
+        // The kernel cannot copy between these two, so try the next way
+        method = method == COPY_FILE_RANGE ? COPY_SENDFILE : COPY_READ_WRITE;
+        if(method == COPY_READ_WRITE && errno != EAGAIN) {
+            writer->kernelCopies = 0;
+        }
+    }
+
+    // Small files are read into the output buffer, which costs fewer calls than a mapping
+    if(S_ISREG(input.st_mode) && input.st_size > OUTPUT_COPY_LIMIT) {
+        int result = copyWithMap(inputFd, &input, writer);
+        if(result != COPY_READ_ERROR) {
+            return result;
+        }
+    }
+    return copyWithRead(inputFd, writer);
+}
+
+/**
+ * @brief Chooses the fastest way to copy between two kinds of file.
+ * 
+ * The kernel copies need a regular file to read from. Files that claim to be
+ * empty, like those in /proc, are read with read so that nothing is missed.
+ * 
+ * @param input The status of the file to copy from.
+ * @param output The status of the file to copy to.
+ * @return int One of the COPY_ methods.
+ */
+int chooseCopyMethod(const struct stat *input, const struct stat *output) {
+#ifdef __linux__
+    if(!S_ISREG(input->st_mode) || input->st_size == 0) {
+        return COPY_READ_WRITE;
+    }
+    if(S_ISREG(output->st_mode)) {
+        return COPY_FILE_RANGE;
+    }
+    if(S_ISFIFO(output->st_mode)) {
+        return COPY_SPLICE;
+    }
+    return COPY_SENDFILE;
+#else
+    (void)input;
+    (void)output;
+    return COPY_READ_WRITE;
+#endif
+}
+
+/**
+ * @brief Copies the next chunk of a file inside the kernel.
+ * 
+ * @param method COPY_FILE_RANGE, COPY_SPLICE or COPY_SENDFILE.
+ * @param inputFd The descriptor to copy from.
+ * @param outputFd The descriptor to copy to.
+ * @return ssize_t The number of bytes copied, 0 at the end of the input, or -1 with errno set.
+ */
+ssize_t copyChunk(int method, int inputFd, int outputFd) {
+#ifdef __linux__
+    if(method == COPY_FILE_RANGE) {
+        return copy_file_range(inputFd, NULL, outputFd, NULL, COPY_CHUNK_SIZE, 0);
+    }
+    if(method == COPY_SPLICE) {
+        return splice(inputFd, NULL, outputFd, NULL, COPY_CHUNK_SIZE, SPLICE_F_MORE);
+    }
+    if(method == COPY_SENDFILE) {
+        return sendfile(outputFd, inputFd, NULL, COPY_CHUNK_SIZE);
+    }
+#else
+    (void)method;
+    (void)inputFd;
+    (void)outputFd;
+#endif
+    errno = ENOSYS;
+    return -1;
+}
+
+/**
+ * @brief Copies the rest of a regular file to an output from a memory mapping.
+ * 
+ * The file is mapped from its current offset to the size it had when fstat
+ * was called, written straight from the mapping, and the offset is moved past
+ * what was written. Anything added to the file since is left for the caller.
+ * 
+ * @param inputFd The descriptor of the regular file.
+ * @param input The status of the file.
+ * @param writer The output to copy to; it is flushed before the mapping is removed.
+ * @return int COPY_OK, COPY_WRITE_ERROR, or COPY_READ_ERROR if the file cannot be mapped.
+ */
+int copyWithMap(int inputFd, const struct stat *input, OutputWriter *writer) {
+    off_t offset = lseek(inputFd, 0, SEEK_CUR);
+    long pageSize = sysconf(_SC_PAGESIZE);
+
+    if(offset < 0 || offset >= input->st_size) {
+        return offset < 0 ? COPY_READ_ERROR : COPY_OK;
+    }
+
+    // Mappings start on a page, so map from the page holding the offset
+    off_t start = offset - offset % pageSize;
+    size_t length = input->st_size - start;
+    char *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, inputFd, start);
+    counts.maps++;
+    if(data == MAP_FAILED) {
+        return COPY_READ_ERROR;
+    }
+    madvise(data, length, MADV_SEQUENTIAL);
+
+    int result = COPY_OK;
+    if(outputMapped(writer, data + (offset - start), input->st_size - offset) != 0 ||
+       flushOutput(writer) != 0) {
+        result = COPY_WRITE_ERROR;
+    }
+    munmap(data, length);
+    counts.maps++;
+    lseek(inputFd, input->st_size, SEEK_SET);
+
+    if(result == COPY_OK) {
+        // Read anything added to the file while it was being written
+        return copyWithRead(inputFd, writer);
+    }
+    return result;
+}
+
+/**
+ * @brief Copies everything left in a file descriptor to an output with read.
+ * 
+ * The file is read straight into the free part of the output buffer.
+ * 
+ * @param inputFd The descriptor to copy from.
+ * @param writer The output to copy to.
+ * @return int COPY_OK, COPY_READ_ERROR or COPY_WRITE_ERROR.
+ */
+int copyWithRead(int inputFd, OutputWriter *writer) {
+    while(1) {
+        if((writer->used == OUTPUT_BUFFER_SIZE || writer->pieceCount == OUTPUT_VECTORS) &&
+           flushOutput(writer) != 0) {
+            return COPY_WRITE_ERROR;
+        }
+
+        char *space = writer->buffer + writer->used;
+        ssize_t count = read(inputFd, space, OUTPUT_BUFFER_SIZE - writer->used);
+
+        counts.reads++;
+        if(count == 0) {
+            return COPY_OK;
+        }
+        if(count < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return COPY_READ_ERROR;
+        }
+
+        recordBuffered(writer, count);
+    }
+}
+
+/**
+ * @brief Sets up an output to collect what is written to a descriptor.
+ * 
+ * @param writer The output to set up.
+ * @param fd The descriptor the output goes to.
+ */
+void initOutput(OutputWriter *writer, int fd) {
+    writer->fd = fd;
+    writer->used = 0;
+    writer->pieceCount = 0;
+    writer->kernelCopies = 1;
+    if(posix_memalign((void **)&writer->buffer, OUTPUT_ALIGNMENT, OUTPUT_BUFFER_SIZE) != 0) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Adds bytes to an output, copying them into its buffer.
+ * 
+ * Pieces larger than OUTPUT_COPY_LIMIT are not copied but written from where
+ * they are, so such pieces must stay unchanged until the output is flushed.
+ * 
+ * @param writer The output to add to.
+ * @param data The bytes to add.
+ * @param length The number of bytes.
+ * @return int 0 on success, -1 if a write failed.
+ */
+int outputBytes(OutputWriter *writer, const char *data, size_t length) {
+    if(length > OUTPUT_COPY_LIMIT) {
+        return outputMapped(writer, data, length);
+    }
+    if((length > OUTPUT_BUFFER_SIZE - writer->used || writer->pieceCount == OUTPUT_VECTORS) &&
+       flushOutput(writer) != 0) {
+        return -1;
+    }
+    memcpy(writer->buffer + writer->used, data, length);
+    recordBuffered(writer, length);
+    return 0;
+}
+
+/**
+ * @brief Adds the bytes just placed after the used part of the buffer to an output.
+ * 
+ * The caller makes sure there is room in the buffer and in the list of pieces.
+ * 
+ * @param writer The output to add to.
+ * @param length The number of bytes placed in the buffer.
+ */
+void recordBuffered(OutputWriter *writer, size_t length) {
+    char *start = writer->buffer + writer->used;
+
+    writer->used += length;
+    if(writer->pieceCount > 0) {
+        struct iovec *last = &writer->pieces[writer->pieceCount - 1];
+
+        if((char *)last->iov_base + last->iov_len == start) {
+            last->iov_len += length;
+            return;
+        }
+    }
+    writer->pieces[writer->pieceCount].iov_base = start;
+    writer->pieces[writer->pieceCount++].iov_len = length;
+}
+
+/**
+ * @brief Adds bytes to an output without copying them.
+ * 
+ * The bytes are written from where they are, so they must stay unchanged until
+ * the output is flushed.
+ * 
+ * @param writer The output to add to.
+ * @param data The bytes to add.
+ * @param length The number of bytes.
+ * @return int 0 on success, -1 if a write failed.
+ */
+int outputMapped(OutputWriter *writer, const char *data, size_t length) {
+    if(length == 0) {
+        return 0;
     }
-    printf("\n");
+
+    // Extend the last piece if it ends where these bytes start
+    if(writer->pieceCount > 0) {
+        struct iovec *last = &writer->pieces[writer->pieceCount - 1];
+
+        if((char *)last->iov_base + last->iov_len == data) {
+            last->iov_len += length;
+            return 0;
+        }
+    }
+    if(writer->pieceCount == OUTPUT_VECTORS && flushOutput(writer) != 0) {
+        return -1;
+    }
+    writer->pieces[writer->pieceCount].iov_base = (char *)data;
+    writer->pieces[writer->pieceCount++].iov_len = length;
+    return 0;
+}
+
+/**
+ * @brief Writes everything collected in an output, however many writev calls it takes.
+ * 
+ * The output is empty afterwards, even if a write failed.
+ * 
+ * @param writer The output to flush.
+ * @return int 0 on success, -1 if a write failed.
+ */
+int flushOutput(OutputWriter *writer) {
+    struct iovec *piece = writer->pieces;
+    int remaining = writer->pieceCount;
+    int result = 0;
+
+    while(remaining > 0) {
+        ssize_t written = writev(writer->fd, piece, remaining);
+
+        counts.writes++;
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            result = -1;
+            break;
+        }
+        counts.bytes += written;
+
+        // Skip the pieces that were written, and the written part of the next
+        while(remaining > 0 && (size_t)written >= piece->iov_len) {
+            written -= piece->iov_len;
+            piece++;
+            remaining--;
+        }
+        if(remaining > 0) {
+            piece->iov_base = (char *)piece->iov_base + written;
+            piece->iov_len -= written;
+        }
+    }
+    writer->used = 0;
+    writer->pieceCount = 0;
+    return result;
 }
 
+/**
+ * @brief Returns the time from a monotonic clock.
+ * 
+ * @return double The time in seconds.
+ */
+double currentSeconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Starts counting the work done for one file, if --stats was given.
+ */
+void startFileStats(void) {
+    if(showStats) {
+        flushOutput(&output);
+        counts.seconds = currentSeconds();
+        fileStart = counts;
+    }
+}
+
+/**
+ * @brief Reports the work done for one file to stderr, if --stats was given.
+ * 
+ * The output is flushed first, so the file's own writes are counted.
+ * 
+ * @param fileName The name of the file.
+ */
+void reportFileStats(const char *fileName) {
+    if(!showStats) {
+        return;
+    }
+    flushOutput(&output);
+    counts.seconds = currentSeconds();
+
+    EchoStats file = {
+        counts.bytes - fileStart.bytes, counts.seconds - fileStart.seconds, counts.reads - fileStart.reads,
+        counts.writes - fileStart.writes, counts.copies - fileStart.copies, counts.maps - fileStart.maps
+    };
+    printStats(fileName, &file);
+
+    totalStats.bytes += file.bytes;
+    totalStats.seconds += file.seconds;
+    totalStats.reads += file.reads;
+    totalStats.writes += file.writes;
+    totalStats.copies += file.copies;
+    totalStats.maps += file.maps;
+    statsFiles++;
+}
+
+/**
+ * @brief Prints one line of --stats to stderr.
+ * 
+ * @param label The file name, or a label for the total.
+ * @param stats The work done.
+ */
+void printStats(const char *label, const EchoStats *stats) {
+    double rate = stats->seconds > 0 ? stats->bytes / 1e6 / stats->seconds : 0;
+
+    fprintf(stderr, "%s: %.0f bytes in %.6f s, %.1f MB/s, %ld syscalls "
+            "(%ld read, %ld write, %ld copy, %ld map)\n", label, stats->bytes, stats->seconds, rate,
+            stats->reads + stats->writes + stats->copies + stats->maps,
+            stats->reads, stats->writes, stats->copies, stats->maps);
+}
+
+/**
+ * @brief Prints the lines of a file that --match selects.
+ * 
+ * The text filtered is the file followed by the newline that echoing adds, so
+ * a last line without a newline gets one, and the echo's empty line after a
+ * file that ends in a newline is printed only if it is selected. A regular
+ * file is memory-mapped and its selected lines are written straight from the
+ * mapping; anything else goes through filterWithRead.
+ * 
+ * @param inputFd The descriptor to filter, from its current offset.
+ * @param writer The output the selected lines go to; it is flushed before returning.
+ * @return int COPY_OK, COPY_READ_ERROR or COPY_WRITE_ERROR.
+ */
+int filterFileData(int inputFd, OutputWriter *writer) {
+    struct stat input;
+    off_t offset = lseek(inputFd, 0, SEEK_CUR);
+
+    if(fstat(inputFd, &input) != 0) {
+        return COPY_READ_ERROR;
+    }
+    if(!S_ISREG(input.st_mode) || offset < 0 || offset >= input.st_size) {
+        return filterWithRead(inputFd, NULL, 0, writer);
+    }
+
+    // Mappings start on a page, so map from the page holding the offset
+    long pageSize = sysconf(_SC_PAGESIZE);
+    off_t start = offset - offset % pageSize;
+    size_t length = input.st_size - start;
+    char *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, inputFd, start);
+    counts.maps++;
+    if(data == MAP_FAILED) {
+        return filterWithRead(inputFd, NULL, 0, writer);
+    }
+    madvise(data, length, MADV_SEQUENTIAL);
+
+    // Filter the whole lines, then hand the last partial line on with the rest of the file
+    const char *text = data + (offset - start);
+    size_t textLength = input.st_size - offset;
+    size_t consumed;
+    int result = COPY_WRITE_ERROR;
+    if(filterLines(text, textLength, 0, writer, &consumed) == 0 && flushOutput(writer) == 0) {
+        lseek(inputFd, input.st_size, SEEK_SET);
+        result = filterWithRead(inputFd, text + consumed, textLength - consumed, writer);
+    }
+    flushOutput(writer);
+    munmap(data, length);
+    counts.maps++;
+    return result;
+}
+
+/**
+ * @brief Prints the lines selected by --match from some text and the rest of a file.
+ * 
+ * The file is read in large blocks. The whole lines of each block are filtered
+ * and written straight from the block, and a partial line at its end is moved
+ * to the front to be completed by the next read.
+ * 
+ * @param inputFd The descriptor to read the rest of the text from, or -1 if there is no more.
+ * @param data Text already read, or NULL.
+ * @param length The number of bytes of text already read.
+ * @param writer The output the selected lines go to; it is flushed before returning.
+ * @return int COPY_OK, COPY_READ_ERROR or COPY_WRITE_ERROR.
+ */
+int filterWithRead(int inputFd, const char *data, size_t length, OutputWriter *writer) {
+    size_t consumed;
+
+    if(inputFd < 0) {
+        if(filterLines(data, length, 1, writer, &consumed) != 0 || flushOutput(writer) != 0) {
+            flushOutput(writer);
+            return COPY_WRITE_ERROR;
+        }
+        return COPY_OK;
+    }
+
+    size_t capacity = FILTER_BUFFER_SIZE;
+    while(capacity < length * 2) {
+        capacity *= 2;
+    }
+    char *buffer = malloc(capacity);
+    if(buffer == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    if(length > 0) {
+        memcpy(buffer, data, length);
+    }
+
+    int result = COPY_OK;
+    while(1) {
+        // A line longer than the buffer makes it grow
+        if(length == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+            if(buffer == NULL) {
+                fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+                exit(1);
+            }
+        }
+
+        ssize_t count = read(inputFd, buffer + length, capacity - length);
+        counts.reads++;
+        if(count < 0 && errno == EINTR) {
+            continue;
+        }
+        if(count < 0) {
+            result = COPY_READ_ERROR;
+            break;
+        }
+
+        int final = count == 0;
+        length += count;
+        if(filterLines(buffer, length, final, writer, &consumed) != 0 || flushOutput(writer) != 0) {
+            result = COPY_WRITE_ERROR;
+            break;
+        }
+        if(final) {
+            break;
+        }
+        memmove(buffer, buffer + consumed, length - consumed);
+        length -= consumed;
+    }
+    flushOutput(writer);
+    free(buffer);
+    return result;
+}
+
+/**
+ * @brief Adds the lines of some text selected by --match to an output.
+ * 
+ * The pattern is searched for across the whole text rather than line by line,
+ * and memchr and memrchr find the edges of the line around each match. The
+ * selected lines are added without being copied, so the text must stay
+ * unchanged until the output is flushed. Runs of selected lines that follow
+ * each other become a single piece of output.
+ * 
+ * @param data The text to filter, starting at the start of a line.
+ * @param length The number of bytes of text.
+ * @param final Set if the text ends the file; its last line is then filtered
+ *              as if it ended in a newline, which is added when it is printed.
+ *              Otherwise a partial last line is left for the next call.
+ * @param writer The output the selected lines go to.
+ * @param consumed Set to the number of bytes of text filtered.
+ * @return int 0 on success, -1 if a write failed.
+ */
+int filterLines(const char *data, size_t length, int final, OutputWriter *writer, size_t *consumed) {
+    const char *end = data + length;
+    const char *position = data;
+
+    if(!final) {
+        // Leave the partial last line for later
+        const char *lastNewline = length > 0 ? memrchr(data, '\n', length) : NULL;
+        end = lastNewline != NULL ? lastNewline + 1 : data;
+    }
+    *consumed = end - data;
+
+    while(position < end) {
+        const char *match = findPattern(position, end - position, matchPattern, matchLength);
+        const char *lineStart = end;
+        const char *lineEnd = end;
+
+        if(match != NULL) {
+            const char *newline = memrchr(position, '\n', match - position);
+            lineStart = newline != NULL ? newline + 1 : position;
+            newline = memchr(match, '\n', end - match);
+            lineEnd = newline != NULL ? newline + 1 : end;
+        }
+
+        // Print the matching line, or with --invert every line before it
+        const char *from = invertMatch ? position : lineStart;
+        const char *to = invertMatch ? lineStart : lineEnd;
+        if(outputMapped(writer, from, to - from) != 0) {
+            return -1;
+        }
+        position = lineEnd;
+    }
+
+    if(final) {
+        // The newline added after the file ends the last line, or is an empty line of its own
+        int lastLineOpen = length > 0 && data[length - 1] != '\n';
+        int selected;
+
+        if(lastLineOpen) {
+            const char *newline = memrchr(data, '\n', length);
+            const char *lineStart = newline != NULL ? newline + 1 : data;
+            selected = (findPattern(lineStart, end - lineStart, matchPattern, matchLength) != NULL) != invertMatch;
+            if(selected && outputBytes(writer, "\n", 1) != 0) {
+                return -1;
+            }
+        } else if((matchLength == 0) != invertMatch && outputBytes(writer, "\n", 1) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Chooses the fastest pattern search that this CPU supports.
+ * 
+ * @return PatternSearch The AVX2 search, the SSE2 search, or the scalar fallback.
+ */
+PatternSearch selectPatternSearch(void) {
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return findPatternAvx2;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        return findPatternSse2;
+    }
+#endif
+    return findPatternScalar;
+}
+
+/**
+ * @brief Finds the first place a pattern occurs in some text.
+ * 
+ * @param text The text to search.
+ * @param length The number of bytes of text.
+ * @param pattern The bytes to find.
+ * @param patternLength The number of bytes in the pattern; an empty pattern is found at the start.
+ * @return const char* The first occurrence, or NULL if there is none.
+ */
+const char *findPatternScalar(const char *text, size_t length, const char *pattern, size_t patternLength) {
+    if(patternLength == 0) {
+        return text;
+    }
+    return memmem(text, length, pattern, patternLength);
+}
+
+#ifdef HAVE_X86_KERNELS
+/**
+ * @brief SSE2 version of findPatternScalar, sixteen places at a time.
+ * 
+ * Each place is checked for the first and the last byte of the pattern at
+ * once, and only the places where both are right are compared in full.
+ * Patterns of one byte use memchr.
+ */
+__attribute__((target("sse2")))
+const char *findPatternSse2(const char *text, size_t length, const char *pattern, size_t patternLength) {
+    if(patternLength < 2 || length < patternLength) {
+        return patternLength == 1 ? memchr(text, pattern[0], length) : findPatternScalar(text, length, pattern, patternLength);
+    }
+
+    __m128i first = _mm_set1_epi8(pattern[0]);
+    __m128i last = _mm_set1_epi8(pattern[patternLength - 1]);
+    size_t places = length - patternLength + 1;
+    size_t i = 0;
+
+    for(; i + 16 <= places; i += 16) {
+        __m128i starts = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i ends = _mm_loadu_si128((const __m128i *)(text + i + patternLength - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(starts, first), _mm_cmpeq_epi8(ends, last)));
+
+        while(mask != 0) {
+            size_t place = i + __builtin_ctz(mask);
+            if(memcmp(text + place + 1, pattern + 1, patternLength - 2) == 0) {
+                return text + place;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findPatternScalar(text + i, length - i, pattern, patternLength);
+}
+
+/**
+ * @brief AVX2 version of findPatternScalar, thirty-two places at a time.
+ */
+__attribute__((target("avx2")))
+const char *findPatternAvx2(const char *text, size_t length, const char *pattern, size_t patternLength) {
+    if(patternLength < 2 || length < patternLength) {
+        return patternLength == 1 ? memchr(text, pattern[0], length) : findPatternScalar(text, length, pattern, patternLength);
+    }
+
+    __m256i first = _mm256_set1_epi8(pattern[0]);
+    __m256i last = _mm256_set1_epi8(pattern[patternLength - 1]);
+    size_t places = length - patternLength + 1;
+    size_t i = 0;
+
+    for(; i + 32 <= places; i += 32) {
+        __m256i starts = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i ends = _mm256_loadu_si256((const __m256i *)(text + i + patternLength - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(starts, first),
+                                                              _mm256_cmpeq_epi8(ends, last)));
+
+        while(mask != 0) {
+            size_t place = i + __builtin_ctz(mask);
+            if(memcmp(text + place + 1, pattern + 1, patternLength - 2) == 0) {
+                return text + place;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findPatternScalar(text + i, length - i, pattern, patternLength);
+}
+#endif
+
 /**
  * @brief Prints the contents of files listed in a file.
  * 
  * This functions reads each line of a file list, where each line contains the
- * name of a file to open and print. 
+ * name of a file to open and print. With more than one thread set by -j, and
+ * without -f, the files are read ahead by a pool of workers while earlier files
+ * are printed, which hides the time spent opening and reading many small files.
+ * The output and error messages come out in list order either way.
  * 
  * @param inputFile A pointer to the file that contains the list of filenames.
  */
 void printFileFromList(FILE *inputFile) {
+    if(prefetchThreads > 1 && !followMode) {
+        size_t fileCount;
+        char **names = readFileList(inputFile, &fileCount);
+
+        printPrefetchedFiles(names, fileCount);
+        for(size_t i = 0; i < fileCount; i++) {
+            free(names[i]);
+        }
+        free(names);
+        return;
+    }
+
     // Buffer to hold each line from the file list
     char fileName[SIZE];
 
@@ -132,10 +1123,561 @@ void printFileFromList(FILE *inputFile) {
         FILE *fileToPrint = openFile(fileName);
         
         if(!fileToPrint) {
+            flushOutput(&output);
             fprintf(stderr, "Error: Could not open file '%s' from file list.\n", fileName);
             continue;
         }
+        if(followMode && followFile(&follower, fileName) == 0) {
+            fclose(fileToPrint);
+            continue;
+        }
+        startFileStats();
         printFileContent(fileToPrint);
         fclose(fileToPrint);
+        reportFileStats(fileName);
         }
-    }
\ No newline at end of file
+    }
+
+/**
+ * @brief Reads every file name from a file list.
+ * 
+ * Names are read a line at a time, exactly as printFileFromList reads them.
+ * 
+ * @param inputFile A pointer to the file that contains the list of filenames.
+ * @param fileCount Set to the number of names read.
+ * @return char** The file names, each allocated with malloc, in list order.
+ */
+char **readFileList(FILE *inputFile, size_t *fileCount) {
+    size_t capacity = 64;
+    char **names = malloc(capacity * sizeof(*names));
+    char fileName[SIZE];
+
+    *fileCount = 0;
+    while(names != NULL && fgets(fileName, SIZE, inputFile) != NULL) {
+        fileName[strcspn(fileName, "\n")] = 0;
+
+        if(*fileCount == capacity) {
+            capacity *= 2;
+            names = realloc(names, capacity * sizeof(*names));
+            if(names == NULL) {
+                break;
+            }
+        }
+        names[*fileCount] = strdup(fileName);
+        if(names[(*fileCount)++] == NULL) {
+            names = NULL;
+        }
+    }
+    if(names == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    return names;
+}
+
+/**
+ * @brief Prints files from a list while a pool of workers reads the next ones.
+ * 
+ * Workers take the files in list order and read the start of each into a
+ * window of slots. The main thread prints the slots in list order, copying the
+ * rest of any file too large for its slot straight from the file, so the
+ * output is the same no matter which worker finishes first.
+ * 
+ * @param names The files to print.
+ * @param fileCount The number of files.
+ */
+void printPrefetchedFiles(char **names, size_t fileCount) {
+    PrefetchJob job = {0};
+    size_t threadCount = (size_t)prefetchThreads < fileCount ? (size_t)prefetchThreads : fileCount;
+
+    if(fileCount == 0) {
+        return;
+    }
+
+    job.names = names;
+    job.fileCount = fileCount;
+    job.window = threadCount * 4;
+    job.bufferLimit = PREFETCH_MEMORY / job.window;
+    job.files = malloc(job.window * sizeof(*job.files));
+    job.ready = calloc(job.window, 1);
+    pthread_t *threads = malloc(threadCount * sizeof(*threads));
+    if(job.files == NULL || job.ready == NULL || threads == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    fflush(stdout);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+    for(size_t i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, prefetchFiles, &job);
+    }
+
+    // Print the files in list order
+    while(job.printedFiles < fileCount) {
+        size_t slot = job.printedFiles % job.window;
+
+        pthread_mutex_lock(&job.lock);
+        while(!job.ready[slot]) {
+            pthread_cond_wait(&job.changed, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        printPrefetchedFile(&job.files[slot], names[job.printedFiles]);
+
+        pthread_mutex_lock(&job.lock);
+        job.ready[slot] = 0;
+        job.printedFiles++;
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    for(size_t i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.changed);
+    free(threads);
+    free(job.files);
+    free(job.ready);
+}
+
+/**
+ * @brief Worker thread that reads files of a list ahead of their turn.
+ * 
+ * A worker takes the next file as long as it fits in the window of files that
+ * the main thread has not printed yet.
+ * 
+ * @param arg The PrefetchJob shared by all workers.
+ * @return void* Always NULL.
+ */
+void *prefetchFiles(void *arg) {
+    PrefetchJob *job = arg;
+
+    pthread_mutex_lock(&job->lock);
+    while(1) {
+        while(job->nextFile < job->fileCount && job->nextFile >= job->printedFiles + job->window) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if(job->nextFile >= job->fileCount) {
+            break;
+        }
+        size_t file = job->nextFile++;
+        pthread_mutex_unlock(&job->lock);
+
+        size_t slot = file % job->window;
+        readFileAhead(job->names[file], &job->files[slot], job->bufferLimit);
+
+        pthread_mutex_lock(&job->lock);
+        job->ready[slot] = 1;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/**
+ * @brief Opens a file and reads as much of it as fits in one slot.
+ * 
+ * The file is read until its end or until bufferLimit bytes are read; a
+ * compressed file is read as the text it decodes to. If the end was not
+ * reached, the file is left open so the rest can be copied when it is printed.
+ * 
+ * @param fileName The file to read.
+ * @param file The slot that receives the contents and status of the file.
+ * @param bufferLimit Most bytes to read into memory.
+ */
+void readFileAhead(const char *fileName, PrefetchedFile *file, size_t bufferLimit) {
+    struct stat info;
+    size_t capacity = 0;
+
+    file->data = NULL;
+    file->length = 0;
+    file->status = PREFETCH_OK;
+    file->reads = 0;
+    file->fd = open(fileName, O_RDONLY);
+    if(file->fd < 0) {
+        file->status = PREFETCH_OPEN_ERROR;
+        return;
+    }
+
+    // Compressed files are decoded on one thread, as the files already run in parallel
+    int textFd = openDecompressed(file->fd, fileName, 1);
+    if(textFd != file->fd) {
+        close(file->fd);
+        file->fd = textFd;
+        if(textFd < 0) {
+            file->status = PREFETCH_OPEN_ERROR;
+            return;
+        }
+    }
+
+    // Ask for one byte more than the size, so the end of the file is seen
+    if(fstat(file->fd, &info) == 0) {
+        capacity = bufferLimit;
+        if(S_ISREG(info.st_mode) && (size_t)info.st_size < bufferLimit) {
+            capacity = (size_t)info.st_size + 1;
+        }
+        file->data = malloc(capacity);
+        if(file->data == NULL) {
+            capacity = 0;
+        }
+    }
+
+    while(file->length < capacity) {
+        ssize_t count = read(file->fd, file->data + file->length, capacity - file->length);
+
+        file->reads++;
+        if(count < 0 && errno == EINTR) {
+            continue;
+        }
+        if(count <= 0) {
+            if(count < 0) {
+                file->status = PREFETCH_READ_ERROR;
+            }
+            close(file->fd);
+            file->fd = -1;
+            break;
+        }
+        file->length += count;
+    }
+}
+
+/**
+ * @brief Prints a file that was read ahead, followed by a newline.
+ * 
+ * Errors are reported at the file's place in the list, with the same messages
+ * as when the file is printed without reading ahead.
+ * 
+ * @param file The file as it was read ahead; its memory and descriptor are released.
+ * @param fileName The name of the file, for error messages.
+ */
+void printPrefetchedFile(PrefetchedFile *file, const char *fileName) {
+    int result = COPY_OK;
+
+    if(file->status == PREFETCH_OPEN_ERROR) {
+        flushOutput(&output);
+        fprintf(stderr, "Error: Could not open file '%s' from file list.\n", fileName);
+        return;
+    }
+
+    startFileStats();
+    counts.reads += file->reads;
+
+    if(matchPattern != NULL) {
+        // The lines are written from the slot, which filterWithRead flushes before returning
+        result = filterWithRead(file->fd, file->data, file->length, &output);
+        if(result == COPY_OK && file->status == PREFETCH_READ_ERROR) {
+            result = COPY_READ_ERROR;
+        }
+    } else if(outputBytes(&output, file->data, file->length) != 0 ||
+       (file->length > OUTPUT_COPY_LIMIT && flushOutput(&output) != 0)) {
+        result = COPY_WRITE_ERROR;
+    } else if(file->status == PREFETCH_READ_ERROR) {
+        result = COPY_READ_ERROR;
+    } else if(file->fd >= 0) {
+        result = copyFileData(file->fd, &output);
+    }
+    if(file->fd >= 0) {
+        close(file->fd);
+    }
+    free(file->data);
+
+    if(result != COPY_OK) {
+        flushOutput(&output);
+    }
+    if(result == COPY_READ_ERROR) {
+        fprintf(stderr, "Error reading from file.\n");
+    } else if(result == COPY_WRITE_ERROR) {
+        fprintf(stderr, "Error writing to standard output.\n");
+    }
+    if(matchPattern == NULL) {
+        outputBytes(&output, "\n", 1);
+    }
+    reportFileStats(fileName);
+}
+
+/**
+ * @brief Starts following a file for -f.
+ * 
+ * Only regular files that are not compressed are followed. The file is watched from now on, and is
+ * printed from its start by followFiles, after which only the bytes appended
+ * to it are printed.
+ * 
+ * @param follower The followed files.
+ * @param fileName The name of the file.
+ * @return int 0 if the file is followed, -1 if it cannot be followed or opened.
+ */
+int followFile(Follower *follower, const char *fileName) {
+    if(follower->fileCount == follower->capacity) {
+        follower->capacity = follower->capacity ? follower->capacity * 2 : 16;
+        follower->files = realloc(follower->files, follower->capacity * sizeof(*follower->files));
+        if(follower->files == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+            exit(1);
+        }
+    }
+
+    FollowedFile *file = &follower->files[follower->fileCount];
+    memset(file, 0, sizeof(*file));
+    file->name = strdup(fileName);
+    if(file->name == NULL || openFollowedFile(follower, file) != 0) {
+        free(file->name);
+        return -1;
+    }
+    follower->fileCount++;
+    return 0;
+}
+
+/**
+ * @brief Opens the file that a followed name refers to now.
+ * 
+ * @param follower The followed files.
+ * @param file The followed file; its descriptor, identity and offset are set.
+ * @return int 0 on success, -1 if the name is not an uncompressed regular file that can be opened.
+ */
+int openFollowedFile(Follower *follower, FollowedFile *file) {
+    struct stat info;
+
+    file->fd = open(file->name, O_RDONLY);
+    if(file->fd < 0) {
+        return -1;
+    }
+    if(fstat(file->fd, &info) != 0 || !S_ISREG(info.st_mode) || detectCompression(file->fd) != COMPRESSION_NONE) {
+        close(file->fd);
+        return -1;
+    }
+    file->device = info.st_dev;
+    file->inode = info.st_ino;
+    file->offset = 0;
+    watchFollowedFile(follower, file);
+    return 0;
+}
+
+/**
+ * @brief Asks inotify to report changes to a followed file and to its directory.
+ * 
+ * The file's own watch reports writes, truncation, and the file being moved or
+ * deleted. The directory's watch reports a new file taking the name, which is
+ * how rotation is seen. The inotify descriptor is created on first use.
+ * 
+ * @param follower The followed files.
+ * @param file The followed file; its watches are set.
+ */
+void watchFollowedFile(Follower *follower, FollowedFile *file) {
+    file->watch = -1;
+    file->directoryWatch = -1;
+#ifdef __linux__
+    if(follower->inotifyFd < 0) {
+        follower->inotifyFd = inotify_init1(IN_CLOEXEC);
+        if(follower->inotifyFd < 0) {
+            return;
+        }
+    }
+
+    char directory[4096];
+    const char *slash = strrchr(file->name, '/');
+    if(slash == NULL) {
+        strcpy(directory, ".");
+    } else {
+        snprintf(directory, sizeof(directory), "%.*s", slash == file->name ? 1 : (int)(slash - file->name), file->name);
+    }
+
+    file->watch = inotify_add_watch(follower->inotifyFd, file->name,
+                                    IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    file->directoryWatch = inotify_add_watch(follower->inotifyFd, directory, IN_CREATE | IN_MOVED_TO);
+#else
+    (void)follower;
+#endif
+}
+
+/**
+ * @brief Prints the bytes added to a followed file since it was last printed.
+ * 
+ * A file smaller than what was printed has been truncated, so it is printed
+ * again from its start. When more than one file is followed, a header naming
+ * the file comes before its bytes whenever they follow another file's.
+ * 
+ * @param follower The followed files.
+ * @param index The followed file to print.
+ */
+void printNewData(Follower *follower, size_t index) {
+    FollowedFile *file = &follower->files[index];
+    struct stat info;
+
+    if(fstat(file->fd, &info) != 0) {
+        return;
+    }
+    if(info.st_size < file->offset) {
+        flushOutput(&output);
+        fprintf(stderr, "Warning: File '%s' was truncated; printing it from the start.\n", file->name);
+        lseek(file->fd, 0, SEEK_SET);
+        file->offset = 0;
+        file->pendingLength = 0;
+    }
+    if(info.st_size == file->offset) {
+        return;
+    }
+
+    if(follower->fileCount > 1 && follower->lastPrinted != (long)index) {
+        char header[4200];
+        int length = snprintf(header, sizeof(header), "%s==> %s <==\n",
+                              follower->lastPrinted < 0 ? "" : "\n", file->name);
+        outputBytes(&output, header, length < (int)sizeof(header) ? (size_t)length : sizeof(header) - 1);
+        follower->lastPrinted = index;
+    }
+
+    int result = matchPattern != NULL ? filterNewData(file) : copyFileData(file->fd, &output);
+    flushOutput(&output);
+    if(result == COPY_READ_ERROR) {
+        fprintf(stderr, "Error reading from file.\n");
+    } else if(result == COPY_WRITE_ERROR) {
+        fprintf(stderr, "Error writing to standard output.\n");
+        exit(1);
+    }
+
+    off_t offset = lseek(file->fd, 0, SEEK_CUR);
+    if(offset >= 0) {
+        file->offset = offset;
+    }
+}
+
+/**
+ * @brief Prints the lines added to a followed file that --match selects.
+ * 
+ * Only whole lines are filtered. A last line without its newline yet is kept
+ * until the rest of it is appended.
+ * 
+ * @param file The followed file.
+ * @return int COPY_OK, COPY_READ_ERROR or COPY_WRITE_ERROR.
+ */
+int filterNewData(FollowedFile *file) {
+    while(1) {
+        if(file->pendingLength == file->pendingCapacity) {
+            file->pendingCapacity = file->pendingCapacity ? file->pendingCapacity * 2 : FILTER_BUFFER_SIZE;
+            file->pending = realloc(file->pending, file->pendingCapacity);
+            if(file->pending == NULL) {
+                fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+                exit(1);
+            }
+        }
+
+        ssize_t count = read(file->fd, file->pending + file->pendingLength,
+                             file->pendingCapacity - file->pendingLength);
+        counts.reads++;
+        if(count < 0 && errno == EINTR) {
+            continue;
+        }
+        if(count <= 0) {
+            return count == 0 ? COPY_OK : COPY_READ_ERROR;
+        }
+
+        size_t consumed;
+        file->pendingLength += count;
+        if(filterLines(file->pending, file->pendingLength, 0, &output, &consumed) != 0 ||
+           flushOutput(&output) != 0) {
+            return COPY_WRITE_ERROR;
+        }
+        memmove(file->pending, file->pending + consumed, file->pendingLength - consumed);
+        file->pendingLength -= consumed;
+    }
+}
+
+/**
+ * @brief Switches a followed file to a new file given its name, as after log rotation.
+ * 
+ * If the name now refers to a different file, the rest of the old file is
+ * printed, and the new file is followed from its start. If nothing has the
+ * name yet, the old file is kept until something does.
+ * 
+ * @param follower The followed files.
+ * @param index The followed file to check.
+ */
+void checkRotation(Follower *follower, size_t index) {
+    FollowedFile *file = &follower->files[index];
+    struct stat info;
+
+    if(stat(file->name, &info) != 0 || !S_ISREG(info.st_mode) ||
+       (info.st_dev == file->device && info.st_ino == file->inode)) {
+        return;
+    }
+
+    printNewData(follower, index);
+#ifdef __linux__
+    if(file->watch >= 0) {
+        inotify_rm_watch(follower->inotifyFd, file->watch);
+    }
+#endif
+    close(file->fd);
+    file->pendingLength = 0;
+    if(openFollowedFile(follower, file) != 0) {
+        // Keep the name so that a later file with it is picked up, with
+        // nothing printed from the stand-in so it is not taken as truncated
+        file->fd = open("/dev/null", O_RDONLY);
+        file->device = 0;
+        file->inode = 0;
+        file->offset = 0;
+        file->pendingLength = 0;
+        file->watch = -1;
+        return;
+    }
+
+    flushOutput(&output);
+    fprintf(stderr, "Warning: File '%s' was replaced; following the new file.\n", file->name);
+    printNewData(follower, index);
+}
+
+/**
+ * @brief Prints what is appended to the followed files until the program is stopped.
+ * 
+ * The files are first printed in the order they were given. Then the thread
+ * sleeps in read on the inotify descriptor until a followed file or its
+ * directory changes, and prints the new bytes of the files the events are
+ * about. Without inotify, every file is checked once a second instead.
+ * 
+ * @param follower The followed files.
+ */
+void followFiles(Follower *follower) {
+    for(size_t i = 0; i < follower->fileCount; i++) {
+        printNewData(follower, i);
+    }
+
+#ifdef __linux__
+    char events[FOLLOW_EVENTS] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while(follower->inotifyFd >= 0) {
+        ssize_t length = read(follower->inotifyFd, events, sizeof(events));
+        if(length < 0 && errno == EINTR) {
+            continue;
+        }
+        if(length <= 0) {
+            break;
+        }
+
+        for(char *position = events; position < events + length; ) {
+            struct inotify_event *event = (struct inotify_event *)position;
+            position += sizeof(*event) + event->len;
+
+            for(size_t i = 0; i < follower->fileCount; i++) {
+                FollowedFile *file = &follower->files[i];
+
+                if(event->wd == file->watch && (event->mask & (IN_MODIFY | IN_ATTRIB))) {
+                    printNewData(follower, i);
+                }
+                if((event->wd == file->watch && (event->mask & (IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF))) ||
+                   event->wd == file->directoryWatch) {
+                    checkRotation(follower, i);
+                }
+            }
+        }
+    }
+#endif
+
+    while(1) {
+        sleep(FOLLOW_POLL_SECONDS);
+        for(size_t i = 0; i < follower->fileCount; i++) {
+            printNewData(follower, i);
+            checkRotation(follower, i);
+        }
+    }
+}
\ No newline at end of file
@@ -5,7 +5,11 @@
  * @brief Formatted Input
  * This program takes input of sensor data readings from a file or from standard
  * input, and analyzes the data to calculate the mean, standard deviation, as well
- * as at what time the maximum and minimum data readings were logged.
+ * as at what time the maximum and minimum data readings were logged. Files
+ * compressed with gzip or zstd are decompressed as they are read.
+ * 
+ * Build with: gcc -O2 -pthread -o formattedInput formattedInput.c decompress.c -lm -lz
+ * (add -lzstd when libzstd is installed)
  * 
  * @version 0.1
  * @date 2024-11-23
@@ -17,19 +21,412 @@
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <dirent.h>
+#include "decompress.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
 
 #define MAX_LINE_LENGTH 500
 #define MAX_SENSORS 100
 #define BUFFER 50
+#define ERROR_BUFFER 128            // Room for why sensor data could not be analyzed
+#define READ_BLOCK_SIZE (1 << 20)   // Bytes read at a time from unmappable input
+#define CHUNK_SIZE (8 << 20)        // Bytes of the file parsed as one independent chunk
+#define BLOCK_ROWS 256              // Lines held in a column block before their stats are taken
+#define SEGMENT_ROWS 4096           // Rows of a column file whose stats are taken at once
+#define COLUMN_FILE_MAGIC "SENSCOL1"
+#define COLUMN_FILE_VERSION 1
+#define SKETCH_BUCKETS 1536         // Buckets for each sign of a quantile sketch
+#define SKETCH_ACCURACY 0.01        // Relative error of a quantile from a sketch
+#define SKETCH_MIN_VALUE 1e-4       // Readings smaller than this count as zero in a sketch
+#define FOLLOW_POLL_MS 100          // How often a followed file is checked for new data
+#define CROSS_ROWS 32               // Rows per cache tile of the comoment update
+#define TIME_INDEX_MAGIC "SENSIDX1"
+#define TIME_INDEX_VERSION 1
+#define TIME_INDEX_SUFFIX ".tidx"   // Added to a sensor file name to name its time index
+#define TIME_INDEX_BUCKET 60        // Default seconds covered by each time index entry
+
+/**
+ * @brief Running statistics for a single sensor.
+ * 
+ * Readings are folded in one at a time using Welford's method, so the mean
+ * and variance are available after a single pass without storing the readings.
+ */
+typedef struct {
+    long count;     // Number of readings folded in
+    double mean;    // Running mean of the readings
+    double m2;      // Sum of squared differences from the running mean
+} SensorStats;
+
+/**
+ * @brief Fixed-size sketch of the distribution of one sensor's readings.
+ * 
+ * This is a logarithmic histogram in the style of DDSketch. With
+ * gamma = (1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY), bucket k holds the
+ * readings whose size is in (SKETCH_MIN_VALUE * gamma^(k-1), SKETCH_MIN_VALUE * gamma^k],
+ * with separate buckets for negative readings.
+ * 
+ * Error bound: any quantile whose true reading has a size between SKETCH_MIN_VALUE
+ * and SKETCH_MIN_VALUE * gamma^(SKETCH_BUCKETS-1) (about 2e9) is reported within
+ * SKETCH_ACCURACY (1%) of that reading. Smaller readings are reported as 0, and
+ * larger ones land in the last bucket. Two sketches merge by adding their counts,
+ * so merging loses nothing and gives the same result in any order.
+ * 
+ * A sketch takes about 24 KB, so the sketches of an analysis take about 2.4 MB.
+ * The threaded chunk parser holds one more set per worker, not one per chunk.
+ */
+typedef struct {
+    uint64_t zeroCount;                     // Readings smaller than SKETCH_MIN_VALUE
+    uint64_t positive[SKETCH_BUCKETS];      // Counts of positive readings
+    uint64_t negative[SKETCH_BUCKETS];      // Counts of negative readings
+} QuantileSketch;
+
+/**
+ * @brief Everything gathered from the sensor data while it is parsed.
+ */
+typedef struct {
+    int expectedSensorCount;            // Number of sensors per line, -1 before the first line
+    long totalReadings;                 // Total number of readings processed
+    float maxReading;                   // Track maximum sensor reading
+    float minReading;                   // Track minimum sensor reading
+    char maxTimestamp[BUFFER];          // Timestamp of maximum reading
+    char minTimestamp[BUFFER];          // Timestamp of minimum reading
+    SensorStats stats[MAX_SENSORS];     // Running statistics for each sensor
+    QuantileSketch *sketches;           // Quantile sketch for each sensor, or NULL
+    double (*percentiles)[3];           // p50, p95 and p99 of each sensor kept without sketches, or NULL
+    double *comoments;                  // MAX_SENSORS x MAX_SENSORS comoment matrix, or NULL
+    char error[ERROR_BUFFER];           // Why the data could not be analyzed, or empty
+} SensorAnalysis;
+
+/**
+ * @brief Header at the start of a binary column file.
+ * 
+ * A column file holds the same data as a text sensor file, already parsed. The
+ * header is followed by the timestamp column, with one NUL-padded timestamp of
+ * timestampWidth bytes per row, and then by one column of rowCount floats per
+ * sensor, one after the other. Numbers are stored in the byte order of the
+ * machine that wrote the file.
+ */
+typedef struct {
+    char magic[8];              // COLUMN_FILE_MAGIC
+    uint32_t version;           // COLUMN_FILE_VERSION
+    uint32_t sensorCount;       // Number of sensor columns
+    uint64_t rowCount;          // Number of rows in every column
+    uint32_t timestampWidth;    // Bytes per timestamp
+    uint32_t reserved;          // Always 0
+    uint64_t timestampOffset;   // File offset of the timestamp column
+    uint64_t columnOffset;      // File offset of the first sensor column
+} ColumnFileHeader;
+
+/**
+ * @brief Destination of the rows copied out of column blocks when converting to a column file.
+ */
+typedef struct {
+    char *timestamps;           // Timestamp column of the mapped output file
+    float *columns;             // First sensor column of the mapped output file
+    uint64_t rowCount;          // Rows in every column
+    uint64_t rowsWritten;       // Rows copied so far
+} ColumnFileWriter;
+
+/**
+ * @brief Header of a time index file.
+ * 
+ * A time index sits next to a text sensor file and lets a range query start
+ * reading close to the first line it needs. The header is followed by
+ * entryCount entries in file order. The index is only used while the sensor
+ * file has the size and modification time recorded here.
+ */
+typedef struct {
+    char magic[8];              // TIME_INDEX_MAGIC
+    uint32_t version;           // TIME_INDEX_VERSION
+    uint32_t reserved;          // Always 0
+    int64_t bucketSeconds;      // Seconds covered by each entry
+    uint64_t entryCount;        // Number of entries after the header
+    uint64_t fileSize;          // Size of the sensor file when it was indexed
+    int64_t fileModified;       // Modification time of the sensor file when it was indexed
+} TimeIndexHeader;
+
+/**
+ * @brief Entry of a time index, made for the first line of each time bucket.
+ */
+typedef struct {
+    int64_t time;               // Timestamp of the line in seconds since the epoch
+    uint64_t offset;            // File offset of the start of the line
+} TimeIndexEntry;
+
+/**
+ * @brief Parsed lines stored column by column.
+ * 
+ * Each sensor's readings sit next to each other, so the statistics of a whole
+ * block can be taken with vector kernels instead of one reading at a time.
+ */
+typedef struct {
+    int rows;                                   // Number of lines in the block
+    float columns[MAX_SENSORS][BLOCK_ROWS];     // Readings of each sensor
+    char timestamps[BLOCK_ROWS][BUFFER];        // Timestamp of each line
+    ColumnFileWriter *writer;                   // Also receives each flushed block, or NULL
+} SensorBlock;
+
+/**
+ * @brief Smallest and largest reading in a column, with the first row each occurs at.
+ */
+typedef struct {
+    float min;
+    int minRow;
+    float max;
+    int maxRow;
+} ColumnExtremes;
+
+/**
+ * @brief A set of column kernels for one instruction set.
+ */
+typedef struct {
+    const char *name;
+    double (*sum)(const float *column, int count);
+    double (*squaredDeviations)(const float *column, int count, double mean);
+    void (*extremes)(const float *column, int count, ColumnExtremes *result);
+    void (*crossProducts)(const double *rows, const double *columns, int stride, int count, double result[4][8]);
+} ColumnKernels;
+
+/**
+ * @brief Work shared between the threads that parse a memory-mapped file.
+ * 
+ * The file is cut into CHUNK_SIZE pieces at line boundaries. Workers parse chunks
+ * into partial results, and the main thread merges the partial results in file
+ * order. Only a window of partial results is held at once, so memory does not
+ * grow with the size of the file. The partial results hold no quantile sketches:
+ * each worker adds its chunks to sketches of its own and merges them into the
+ * result's as soon as a chunk is parsed, since sketches merge in any order.
+ */
+typedef struct {
+    const char *data;           // Start of the mapped file
+    size_t length;              // Size of the mapped file
+    size_t chunkCount;          // Number of chunks in the file
+    size_t nextChunk;           // Next chunk for a worker to parse
+    size_t mergedChunks;        // Chunks already merged into the result
+    size_t window;              // Number of partial results held at once
+    SensorAnalysis *partials;   // Partial result of each chunk in the window
+    char *ready;                // Set when a partial result is finished
+    QuantileSketch *sketches;   // Sketches of the result, or NULL without --quantiles
+    pthread_mutex_t sketchLock; // Guards sketches
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} SensorChunkJob;
+
+/**
+ * @brief Work shared between the threads that analyze a batch of files.
+ * 
+ * Workers analyze whole files into results, and the main thread reports and
+ * merges the results in the order the files were given. Only a window of
+ * results is held at once, however many files are in the batch. A file that
+ * cannot be read is reported as skipped instead of ending the batch.
+ * 
+ * With --quantiles, the results hold each file's percentiles but no sketches.
+ * A worker reads every file into one set of sketches of its own, then adds it
+ * to the combined sketches of the files with the same number of sensors, so
+ * the combined report can use the set that matches its sensor count.
+ */
+typedef struct {
+    char **names;               // Files in the order they are reported
+    size_t fileCount;           // Number of files in the batch
+    size_t nextFile;            // Next file for a worker to analyze
+    size_t reportedFiles;       // Files already reported and merged
+    size_t window;              // Number of results held at once
+    SensorAnalysis *results;    // Result of each file in the window
+    off_t *sizes;               // Size of each file in the window
+    const char **errors;        // Why each file in the window was not read, or NULL
+    char *ready;                // Set when a result is finished
+    QuantileSketch *countSketches[MAX_SENSORS + 1]; // Sketches of the files read, by sensor count
+    pthread_mutex_t sketchLock; // Guards countSketches
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} SensorBatchJob;
+
+/**
+ * @brief Sliding window over the most recent rows of a followed input.
+ * 
+ * Rows are numbered in the order they arrive and kept in ring buffers indexed
+ * by row number modulo the capacity, which grows as needed. For every sensor
+ * the window keeps running statistics and monotonic queues of row numbers
+ * whose fronts hold the current maximum and minimum. Taking rows out of the
+ * running statistics leaves rounding error behind, so they are recomputed from
+ * the ring buffer each time as many rows have left as the window holds.
+ */
+typedef struct {
+    int sensors;                    // Readings per row, -1 before the first row
+    long capacity;                  // Rows the ring buffers can hold, a power of two
+    long head;                      // Number of the oldest row in the window
+    long tail;                      // Number of the next row to arrive
+    float *values;                  // Readings of each row in the window
+    double *arrivals;               // Arrival time of each row in the window
+    long *maxQueue;                 // Queue of rows that may become each sensor's maximum
+    long *minQueue;                 // Queue of rows that may become each sensor's minimum
+    long maxFront[MAX_SENSORS];     // Position of the front of each maximum queue
+    long maxBack[MAX_SENSORS];      // Position past the back of each maximum queue
+    long minFront[MAX_SENSORS];     // Position of the front of each minimum queue
+    long minBack[MAX_SENSORS];      // Position past the back of each minimum queue
+    SensorStats stats[MAX_SENSORS]; // Running statistics of the rows in the window
+    long removedRows;               // Rows dropped since the statistics were recomputed
+    char lastTimestamp[BUFFER];     // Timestamp of the newest row
+} RollingWindow;
+
+/**
+ * @brief Settings taken from the command line.
+ */
+typedef struct {
+    int threads;                // Threads used to parse memory-mapped files
+    char *benchFile;            // File to benchmark the parsers on, or NULL
+    char *convertFile;          // Column file to convert the input into, or NULL
+    int quantiles;              // Nonzero to report p50/p95/p99 of each sensor
+    int follow;                 // Nonzero to follow the input and report a sliding window
+    long windowRows;            // Rows in the sliding window, or 0 for no row limit
+    double windowSeconds;       // Seconds covered by the sliding window, or 0 for no time limit
+    double interval;            // Seconds between sliding window reports
+    int batch;                  // Nonzero to analyze every file given, one file per thread
+    char *listFile;             // File listing more sensor files for a batch, or NULL
+    int index;                  // Nonzero to build the time index of the input and exit
+    long indexBucket;           // Seconds covered by each time index entry
+    char *rangeStart;           // First timestamp of the range to analyze, or NULL
+    char *rangeEnd;             // Last timestamp of the range to analyze, or NULL
+    int correlation;            // Nonzero to report the covariance and correlation matrices
+} AnalysisOptions;
 
 // Declaration of functions 
+int parseOptions(int argc, char *argv[]);
 FILE *openFile(char *fileName);
 FILE *writeFile(char *fileName);
 int isValidSensorReading(char *str);
+int parseSensorReading(const char *start, const char *end, float *value);
 void readSensorData(FILE *inputFile, FILE *outputFile);
+void initSensorAnalysis(SensorAnalysis *analysis);
+void initChunkAnalysis(SensorAnalysis *analysis, QuantileSketch *sketches);
+void checkSensorAnalysis(const SensorAnalysis *analysis);
+void mergeChunkAnalysis(SensorAnalysis *analysis, SensorAnalysis *chunk);
+void freeSensorAnalysis(SensorAnalysis *analysis);
+void scanSensorFile(SensorAnalysis *analysis, int fd, int threads);
+void scanSensorStream(SensorAnalysis *analysis, int fd);
+void scanSensorMapping(SensorAnalysis *analysis, const char *data, size_t length, int maxThreads);
+void *scanSensorChunks(void *arg);
+size_t findChunkStart(const char *data, size_t length, size_t chunk);
+size_t parseSensorChunks(SensorAnalysis *analysis, SensorAnalysis *chunk, SensorBlock *block,
+                         size_t *chunkIndex, size_t offset, const char *data, size_t length, int final);
+void parseSensorChunk(SensorAnalysis *chunk, SensorBlock *block, QuantileSketch *sketches,
+                      const char *data, size_t length);
+size_t parseSensorBuffer(SensorAnalysis *analysis, SensorBlock *block, const char *data,
+                         size_t length, size_t limit, int final);
+SensorBlock *newSensorBlock(void);
+void flushSensorBlock(SensorAnalysis *analysis, SensorBlock *block);
+void addColumnBlock(SensorAnalysis *analysis, const float *const columns[], int rows,
+                    int *maxRow, int *minRow);
+void scanColumnFile(SensorAnalysis *analysis, const char *data, size_t length);
+int columnFileFits(const ColumnFileHeader *header, size_t length);
+void convertSensorFile(char *inputName, char *outputName);
+size_t countSensorLines(const char *data, size_t length, int *sensorCount);
+void writeSensorBlock(ColumnFileWriter *writer, const SensorBlock *block, int sensorCount);
+void followSensorData(int fd, FILE *outputFile);
+size_t addWindowLines(RollingWindow *window, const char *data, size_t length, int final);
+void initRollingWindow(RollingWindow *window);
+void freeRollingWindow(RollingWindow *window);
+void growRollingWindow(RollingWindow *window);
+void addWindowRow(RollingWindow *window, const float *readings, int count, double arrival);
+void removeWindowRow(RollingWindow *window);
+void recomputeWindowStats(RollingWindow *window);
+void expireWindowRows(RollingWindow *window, double now);
+void removeFromSensorStats(SensorStats *stats, double reading);
+void printWindow(const RollingWindow *window, FILE *outputFile);
+size_t analyzeSensorBatch(char **names, size_t fileCount, FILE *outputFile);
+void *analyzeBatchFiles(void *arg);
+void keepBatchSketches(SensorBatchJob *job, SensorAnalysis *result, int merge);
+char **collectBatchFiles(char **arguments, int argumentCount, char *listFile, size_t *fileCount);
+char **addBatchFile(char **names, size_t *fileCount, size_t *capacity, char *name);
+int parseDigits(const char *position, const char *end, int count, int *value);
+int64_t daysFromCivil(int year, int month, int day);
+int daysInMonth(int year, int month);
+int parseTimestamp(const char *start, size_t length, int64_t *epoch);
+int lineTimestamp(const char *line, const char *end, int64_t *epoch);
+TimeIndexEntry *buildTimeIndex(const char *data, size_t length, int64_t bucketSeconds, size_t *entryCount);
+TimeIndexEntry *loadTimeIndex(char *indexName, const struct stat *info, size_t *entryCount);
+int saveTimeIndex(char *indexName, const struct stat *info, const TimeIndexEntry *entries, size_t entryCount);
+size_t findTimeOffset(const char *data, size_t length, const TimeIndexEntry *entries,
+                      size_t entryCount, int64_t time, int after);
+char *mapTextSensorFile(FILE *inputFile, char *fileName, struct stat *info);
+char *timeIndexName(char *fileName);
+void indexSensorFile(char *fileName);
+void querySensorRange(char *fileName, int64_t startTime, int64_t endTime, FILE *outputFile);
+void mergeSensorAnalysis(SensorAnalysis *analysis, const SensorAnalysis *part);
+void mergeSensorStats(SensorStats *stats, const SensorStats *part);
+void addColumnComoments(SensorAnalysis *analysis, const float *const columns[], int rows,
+                        const SensorStats *parts);
+void mergeComoments(double *comoments, const SensorStats *stats, const double *partComoments,
+                    const SensorStats *partStats, int sensors);
+void printCorrelation(FILE *outputFile, const SensorAnalysis *analysis);
+void addToSketch(QuantileSketch *sketch, const float *column, int count);
+void mergeSketch(QuantileSketch *sketch, const QuantileSketch *part);
+double sketchQuantile(const QuantileSketch *sketch, double quantile);
+void findPercentiles(const QuantileSketch *sketches, int sensorCount, double (*percentiles)[3]);
+int parseSensorLine(SensorAnalysis *analysis, SensorBlock *block, const char *line, const char *end);
+int parseSensorRow(const char *line, const char *end, float *readings, size_t stride,
+                   const char **timeStamp, size_t *timeStampLength, char *error);
+const char *skipBlanks(const char *position, const char *end);
+const char *skipToken(const char *position, const char *end);
+void copyTimestamp(char *dest, const char *timeStamp, size_t length);
+void reportSensorAnalysis(const SensorAnalysis *analysis, FILE *outputFile);
 void calcSensorStats(float readings[], int count, float *mean, float *std_dev);
+void updateSensorStats(SensorStats *stats, double reading);
+void finishSensorStats(const SensorStats *stats, float *mean, float *std_dev);
+const ColumnKernels *selectColumnKernels(void);
+double sumColumnScalar(const float *column, int count);
+double squaredDeviationsScalar(const float *column, int count, double mean);
+void columnExtremesScalar(const float *column, int count, ColumnExtremes *result);
+void crossProductsScalar(const double *rows, const double *columns, int stride, int count, double result[4][8]);
+#ifdef HAVE_X86_KERNELS
+double sumColumnSse(const float *column, int count);
+double squaredDeviationsSse(const float *column, int count, double mean);
+void columnExtremesSse(const float *column, int count, ColumnExtremes *result);
+void crossProductsSse(const double *rows, const double *columns, int stride, int count, double result[4][8]);
+double sumColumnAvx2(const float *column, int count);
+double squaredDeviationsAvx2(const float *column, int count, double mean);
+void columnExtremesAvx2(const float *column, int count, ColumnExtremes *result);
+void crossProductsAvx2(const double *rows, const double *columns, int stride, int count, double result[4][8]);
+#endif
 void printData(FILE *outputFile, float maxReading, char *maxTimestamp, float minReading, 
-               char *minTimestamp, int sensorCount, float *means, float *std_devs);
+               char *minTimestamp, int sensorCount, float *means, float *std_devs,
+               double (*percentiles)[3]);
+double currentSeconds(void);
+void parseSensorDataWithStdio(FILE *inputFile, SensorAnalysis *analysis);
+void benchmarkSensorParsers(char *fileName);
+void benchmarkSensorStages(char *fileName);
+void printBenchmarkLine(const char *label, double seconds, size_t rows, size_t bytes);
+double peakMemory(void);
+void benchmarkColumnKernels(int sensors, long rows);
+
+AnalysisOptions options = { 1, NULL, NULL, 0, 0, 0, 0.0, 1.0, 0, NULL, 0, TIME_INDEX_BUCKET, NULL, NULL, 0 };
+
+// Column kernels for each instruction set, best first
+const ColumnKernels scalarKernels = {
+    "scalar", sumColumnScalar, squaredDeviationsScalar, columnExtremesScalar, crossProductsScalar
+};
+#ifdef HAVE_X86_KERNELS
+const ColumnKernels sseKernels = { "sse2", sumColumnSse, squaredDeviationsSse, columnExtremesSse, crossProductsSse };
+const ColumnKernels avx2Kernels = {
+    "avx2", sumColumnAvx2, squaredDeviationsAvx2, columnExtremesAvx2, crossProductsAvx2
+};
+#endif
+
+// Kernels used for the column statistics, chosen in main for this CPU
+const ColumnKernels *columnKernels = &scalarKernels;
 
 /**
  * @brief main
@@ -40,6 +437,7 @@ void printData(FILE *outputFile, float maxReading, char *maxTimestamp, float min
  * and writes the results to the specified output.
  * The program terminates if there are errors in file reading, writing, 
  * or if the data format is incorrect.
+ * Options given before the file names are handled by parseOptions.
  * 
  * @param argc The number of command line arguments passed to the program.
  * @param argv Array of command line arguments.
@@ -49,58 +447,115 @@ int main (int argc, char *argv[]) {
     //Default to reading and writing from stdio.
     FILE *inputFile = stdin;
     FILE *outputFile = stdout;
-    FILE *file;
 
-    char buffer[MAX_SENSORS];
+    // Options come before the file names
+    int first = parseOptions(argc, argv);
+    int fileCount = argc - first;
+    columnKernels = selectColumnKernels();
+
+    // Compare parse throughput of the stdio and in-place parsers
+    if(options.benchFile != NULL) {
+        benchmarkSensorParsers(options.benchFile);
+        return 0;
+    }
+
+    // Convert a text sensor file into a column file
+    if(options.convertFile != NULL) {
+        if(fileCount != 1) {
+            fprintf(stderr, "Warning: Terminating program (--convert needs one input file).\n");
+            exit(1);
+        }
+        convertSensorFile(argv[first], options.convertFile);
+        return 0;
+    }
+
+    // Build the time index of a sensor file
+    if(options.index) {
+        if(fileCount != 1) {
+            fprintf(stderr, "Warning: Terminating program (--index needs one input file).\n");
+            exit(1);
+        }
+        indexSensorFile(argv[first]);
+        return 0;
+    }
+
+    // Analyze only a time range of a sensor file
+    if(options.rangeStart != NULL) {
+        int64_t startTime, endTime;
+
+        if(fileCount < 1 || fileCount > 2) {
+            fprintf(stderr, "Warning: Terminating program (--range needs one input file).\n");
+            exit(1);
+        }
+        if(!parseTimestamp(options.rangeStart, strlen(options.rangeStart), &startTime) ||
+           !parseTimestamp(options.rangeEnd, strlen(options.rangeEnd), &endTime)) {
+            fprintf(stderr, "Warning: Terminating program (invalid time range).\n");
+            exit(1);
+        }
+        outputFile = fileCount > 1 ? writeFile(argv[first + 1]) : stdout;
+        querySensorRange(argv[first], startTime, endTime, outputFile);
+        if(outputFile != stdout) {
+            fclose(outputFile);
+        }
+        return 0;
+    }
+
+    // Analyze every file given on a pool of threads
+    if(options.batch) {
+        size_t batchCount;
+        char **names = collectBatchFiles(argv + first, fileCount, options.listFile, &batchCount);
+
+        size_t skipped = analyzeSensorBatch(names, batchCount, outputFile);
+        for (size_t i = 0; i < batchCount; i++) {
+            free(names[i]);
+        }
+        free(names);
+        return skipped > 0;
+    }
+
+    // Follow the input and report a sliding window until it ends
+    if(options.follow) {
+        if(fileCount > 2) {
+            fprintf(stderr, "Warning: Terminating program (too many arguments).\n");
+            exit(1);
+        }
+        inputFile = fileCount > 0 ? openFile(argv[first]) : stdin;
+        outputFile = fileCount > 1 ? writeFile(argv[first + 1]) : stdout;
+        followSensorData(fileno(inputFile), outputFile);
+    }
+
     // If loop checks whether to read from stdin or from a file.
-    if(argc == 1){
-        char *fileName = "dataInput.txt";
-
-        file = writeFile(fileName);
-        printf("Reading sensor data from STDIN. Please enter data, line by line." 
-               "Type 'exit' to stop.\n");
-            while (1) {
-                printf("> ");
-                fgets(buffer, sizeof(buffer), stdin);
-
-                if(strncmp(buffer, "exit", 4) == 0 && (buffer[4] == '\n' || buffer[4] == '\0')) {
-                    break;
-                }
-            fputs(buffer, file);
-            }
-    fclose(file);
-    
-    inputFile = openFile(fileName);
-    outputFile = stdout;
-    readSensorData(inputFile, outputFile);
-    fclose(inputFile);
+    else if(fileCount == 0){
+        // Only prompt when someone is typing the data in
+        if(isatty(STDIN_FILENO)) {
+            fprintf(stderr, "Reading sensor data from STDIN. Please enter data, line by line. "
+                            "Press Ctrl-D to stop.\n");
+        }
+        readSensorData(inputFile, outputFile);
     }
 
     // Given one argument, read from a file and output to stdout.
-    else if(argc == 2){
-        inputFile = openFile(argv[1]);
+    else if(fileCount == 1){
+        inputFile = openFile(argv[first]);
         if(!inputFile) {
             exit(1);
         }
     outputFile = stdout;
     readSensorData(inputFile, outputFile);
-    fclose(inputFile);
     }
     
     // Given two arguments, read from a file and output to a file.
-    else if(argc == 3) {
-        inputFile = openFile(argv[1]);
+    else if(fileCount == 2) {
+        inputFile = openFile(argv[first]);
         if(!inputFile) {
             exit(1);
         }
-        outputFile = writeFile(argv[2]);
+        outputFile = writeFile(argv[first + 1]);
         if(!outputFile) {
             fclose(inputFile);
             exit(1);
         }
     readSensorData(inputFile, outputFile);
-    fclose(inputFile);
-    fclose(outputFile);
 
     } else {
 
@@ -118,13 +573,137 @@ int main (int argc, char *argv[]) {
     }
 }
 
+/**
+ * @brief Reads the options given before the file names.
+ * 
+ * Recognized options:
+ *   --threads N   Parse memory-mapped files on N threads (default: one per CPU).
+ *   --bench FILE  Report the parse throughput of the in-place parser against the
+ *                 fgets/strtok/atof parser on FILE, the time of each stage of the
+ *                 fgets/strtok/atof parser, and the speed of each set of column
+ *                 kernels, then exit. sensorGen.c writes files to run it on.
+ *   --quantiles   Also report the 50th, 95th and 99th percentile of each sensor,
+ *                 each within 1% of the true reading. Readings smaller in size
+ *                 than SKETCH_MIN_VALUE (1e-4) count as 0.
+ *   --corr        Also report the covariance and correlation matrices of the sensors.
+ *   --follow      Keep reading the input as it grows, like tail -f, and report
+ *                 statistics over a sliding window of the most recent rows.
+ *   --window-rows N     Sliding window of the last N rows (default 1000).
+ *   --window-seconds T  Sliding window of the rows that arrived in the last T seconds.
+ *   --interval S  Seconds between sliding window reports (default 1).
+ *   --batch       Analyze every file given, and every file directly inside each
+ *                 directory given, on a pool of threads. A report is printed for
+ *                 each file in order, followed by a report of all files together.
+ *                 Files that cannot be read, or that have a different number of
+ *                 sensors, are reported as skipped and the exit status is 1.
+ *   --list FILE   Also analyze the files named in FILE, one per line, as a batch.
+ *   --index       Build the time index of the input file, saved next to it as
+ *                 FILE.tidx, then exit.
+ *   --index-bucket S    Seconds covered by each time index entry (default 60).
+ *   --range T1 T2 Analyze only the lines with timestamps from T1 to T2, using
+ *                 the time index to skip the rest of the file. The index is built
+ *                 if it is missing or out of date. Timestamps may be ISO 8601
+ *                 (2024-11-23T00:00:00), times of day (00:00:00) or epoch seconds.
+ *   --convert OUT Convert the text sensor file given as input into the column
+ *                 file OUT, then exit. Column files are recognized when read
+ *                 and are analyzed without any text parsing.
+ * The program terminates if an option is unknown or is missing its value.
+ * 
+ * @param argc The number of command line arguments passed to the program.
+ * @param argv Array of command line arguments.
+ * @return int The index of the first argument that is not an option.
+ */
+int parseOptions(int argc, char *argv[]) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 1;
+
+    options.threads = processors > 0 ? processors : 1;
+
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        // Options without a value
+        if (strcmp(argv[i], "--quantiles") == 0) {
+            options.quantiles = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--follow") == 0) {
+            options.follow = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--batch") == 0) {
+            options.batch = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--index") == 0) {
+            options.index = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--corr") == 0) {
+            options.correlation = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Warning: Terminating program (missing value after %s).\n", argv[i]);
+            exit(1);
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            options.threads = atoi(argv[++i]);
+            if (options.threads < 1) {
+                fprintf(stderr, "Warning: Terminating program (thread count must be positive).\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            options.benchFile = argv[++i];
+        } else if (strcmp(argv[i], "--convert") == 0) {
+            options.convertFile = argv[++i];
+        } else if (strcmp(argv[i], "--index-bucket") == 0) {
+            options.indexBucket = atol(argv[++i]);
+            if (options.indexBucket < 1) {
+                fprintf(stderr, "Warning: Terminating program (index bucket must be positive).\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--range") == 0) {
+            if (i + 2 >= argc) {
+                fprintf(stderr, "Warning: Terminating program (missing value after %s).\n", argv[i]);
+                exit(1);
+            }
+            options.rangeStart = argv[++i];
+            options.rangeEnd = argv[++i];
+        } else if (strcmp(argv[i], "--list") == 0) {
+            options.listFile = argv[++i];
+            options.batch = 1;
+        } else if (strcmp(argv[i], "--window-rows") == 0) {
+            options.windowRows = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--window-seconds") == 0) {
+            options.windowSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--interval") == 0) {
+            options.interval = atof(argv[++i]);
+            if (options.interval <= 0) {
+                fprintf(stderr, "Warning: Terminating program (interval must be positive).\n");
+                exit(1);
+            }
+        } else {
+            fprintf(stderr, "Warning: Terminating program (unknown option '%s').\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    // Without a window size, follow the last 1000 rows
+    if (options.windowRows <= 0 && options.windowSeconds <= 0) {
+        options.windowRows = 1000;
+    }
+    return i;
+}
+
 /**
  * @brief Opens a file for reading.
  * 
  * This function attempts to open a file for reading 
  * and checks if the file is successfully opened.
  * If the file cannot be opened, an error message is displayed, 
- * and the program terminates.
+ * and the program terminates. A file compressed with gzip or zstd is
+ * decompressed on background threads, and the file returned reads its text.
  * 
  * @param fileName The name of the file to be opened
  * @return FILE* A pointer to the opened file, or NULL if the file cannot be opened.
@@ -135,6 +714,15 @@ FILE *openFile(char *fileName) {
         fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", fileName);
         exit(1);
     }
+
+    int fd = openDecompressed(fileno(file), fileName, options.threads);
+    if(fd < 0) {
+        exit(1);
+    }
+    if(fd != fileno(file)) {
+        fclose(file);
+        file = fdopen(fd, "r");
+    }
     return file;
 }
 
@@ -162,197 +750,3148 @@ FILE *writeFile(char *fileName) {
  * 
  * This function reads sensor data line by line from the input file, processes the data, and computes the maximum,
  * minimum, mean, and standard deviation for each sensor. The results are written to the output file.
+ * Statistics are updated as each line is parsed, so memory use depends only on the
+ * number of sensors and not on the number of lines in the file.
  * 
  * @param inputFile The file from which sensor data is read.
  * @param outputFile The file where the processed data is written.
  */
 void readSensorData(FILE *inputFile, FILE *outputFile) {
-        char timeStamp[BUFFER];             // Stores the timestamp of each reading
-        char line[MAX_LINE_LENGTH];         // Buffer for reading each line of data
-        float readings[MAX_SENSORS];        // Array to store sensor readings
-        int numSensors = 0;                 // Track number of sensors in a line
-        float maxReading = -INFINITY;       // Track maximum sensor reading
-        float minReading = INFINITY;        // Track minimum sensor reading
-        char maxTimestamp[BUFFER] = " ";    // Timestamp of maximum reading
-        char minTimestamp[BUFFER] = " ";    // Timestamp of minimum reading
-        float allReadings[MAX_SENSORS][MAX_LINE_LENGTH]; // Array to store all sensor readings
-        int totalReadings = 0;              // Total number of readings processed
-        int expectedSensorCount = -1;       // Track expected number of sensors in a line
+    SensorAnalysis analysis;
 
-    while (fgets(line, MAX_LINE_LENGTH, inputFile)) {
+    initSensorAnalysis(&analysis);
+    scanSensorFile(&analysis, fileno(inputFile), options.threads);
+    checkSensorAnalysis(&analysis);
+    reportSensorAnalysis(&analysis, outputFile);
+    freeSensorAnalysis(&analysis);
+}
 
-        // Skip empty or whitespace-only lines
-        if (line[0] == '\0' || strspn(line, " \t\n\r") == strlen(line)) {
-            continue;
-        }
+/**
+ * @brief Resets a sensor analysis before any lines are parsed.
+ * 
+ * When quantiles are requested, empty sketches are allocated for every sensor.
+ * Each call must be matched by a call to freeSensorAnalysis.
+ * 
+ * @param analysis The analysis to reset.
+ */
+void initSensorAnalysis(SensorAnalysis *analysis) {
+    initChunkAnalysis(analysis, NULL);
 
-        numSensors = 0;
-        
-        // Extract timestamp from first token in line
-        char *token = strtok(line, " \t");
-        if (token) {
-            strcpy(timeStamp, token); // Store timestamp
-        } else {
-            fprintf(stderr, "Warning: Terminating program (improperly formatted data)");
+    if (options.quantiles) {
+        analysis->sketches = calloc(MAX_SENSORS, sizeof(QuantileSketch));
+        if (analysis->sketches == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
             exit(1);
         }
+    }
+}
 
-        token = strtok(NULL, " \t");      
-        
-        // Process sensor readings in a line
-        while(token != NULL) {
-            if(numSensors >= MAX_SENSORS) { // Check for consistent amount of sensor readings
-                fprintf(stderr, "Warning: Terminating program (inconsistent sensor readings).");
-                exit(1);
-            }
-
-            // Check each sensor reading for validity
-            if (!isValidSensorReading(token)) {
-                fprintf(stderr, "Warning: Terminating program (Invalid sensor reading '%s').\n", token);
-                exit(1);
-            }
-
-            // Convert string toke to float
-            readings[numSensors] = atof(token);
-
-            // Store for later calculations
-            allReadings[numSensors][totalReadings] = readings[numSensors];
-
-            if(readings[numSensors] > maxReading) {
-                maxReading = readings[numSensors];
-                strcpy(maxTimestamp, timeStamp);
-            }
-            if(readings[numSensors] < minReading) {
-                minReading = readings[numSensors];
-                strcpy(minTimestamp, timeStamp);
-            }
-            
-            numSensors++;                 // Move to next sensor reading
-            token = strtok(NULL, " \t");  // Gets next sensors data
-        }
+/**
+ * @brief Resets the partial result of a chunk, which adds to sketches it does not own.
+ * 
+ * The chunk's sketches pointer must be set back to NULL before the chunk is
+ * merged or freed.
+ * 
+ * @param analysis The partial result to reset.
+ * @param sketches The sketches that the chunk's readings are added to, or NULL.
+ */
+void initChunkAnalysis(SensorAnalysis *analysis, QuantileSketch *sketches) {
+    memset(analysis, 0, sizeof(*analysis));
+    analysis->expectedSensorCount = -1;
+    analysis->maxReading = -INFINITY;
+    analysis->minReading = INFINITY;
+    strcpy(analysis->maxTimestamp, " ");
+    strcpy(analysis->minTimestamp, " ");
+    analysis->sketches = sketches;
 
-        // Check for consistent sensor readings
-        if(expectedSensorCount == -1) {
-            expectedSensorCount = numSensors;
-        } else if (numSensors != expectedSensorCount) {
-            fprintf(stderr, "Warning: Terminating program (inconsistent sensor readings).");
+    if (options.correlation) {
+        analysis->comoments = calloc(MAX_SENSORS * MAX_SENSORS, sizeof(double));
+        if (analysis->comoments == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
             exit(1);
         }
-        totalReadings++; // Increment number of readings processed
     }
+}
 
-    if (totalReadings == 0) {
-        fprintf(stderr, "Warning: Terminating program (no sensor data to process).\n");
+/**
+ * @brief Frees the memory held by a sensor analysis.
+ * 
+ * @param analysis The analysis to free.
+ */
+void freeSensorAnalysis(SensorAnalysis *analysis) {
+    free(analysis->sketches);
+    free(analysis->percentiles);
+    free(analysis->comoments);
+    analysis->sketches = NULL;
+    analysis->percentiles = NULL;
+    analysis->comoments = NULL;
+}
+
+/**
+ * @brief Terminates the program if the sensor data could not be analyzed.
+ * 
+ * Parsing records its first error in the analysis rather than exiting, so that
+ * a batch can skip the file. Everything that analyzes a single file checks here.
+ * 
+ * @param analysis The analysis to check.
+ */
+void checkSensorAnalysis(const SensorAnalysis *analysis) {
+    if (analysis->error[0] != '\0') {
+        fprintf(stderr, "Warning: Terminating program (%s).\n", analysis->error);
         exit(1);
     }
+}
 
-    // Arrays to store mean and standard deviation for each sensor
-    float means[MAX_SENSORS];
-    float std_devs[MAX_SENSORS];
+/**
+ * @brief Merges a finished chunk whose sketches are borrowed, then frees it.
+ * 
+ * The chunk's readings are already in the sketches it borrowed, so they are
+ * let go rather than merged a second time.
+ * 
+ * @param analysis The analysis to merge into.
+ * @param chunk The partial result set up with initChunkAnalysis.
+ */
+void mergeChunkAnalysis(SensorAnalysis *analysis, SensorAnalysis *chunk) {
+    chunk->sketches = NULL;
+    mergeSensorAnalysis(analysis, chunk);
+    freeSensorAnalysis(chunk);
+}
 
-    // Send stats from each sensor calculation function
-    for (int i = 0; i < numSensors; i++) {
-        calcSensorStats(allReadings[i], totalReadings, &means[i], &std_devs[i]);
-    }
+/**
+ * @brief Parses all sensor data available from a file descriptor.
+ * 
+ * Regular files are memory-mapped and parsed in place, or analyzed straight from
+ * the mapping if they are column files. Anything that cannot be mapped, such as
+ * a pipe, is read in large blocks and parsed as the blocks arrive.
+ * 
+ * @param analysis The analysis that the readings are added to.
+ * @param fd The file descriptor to read sensor data from.
+ * @param threads The number of threads that parse a memory-mapped text file.
+ */
+void scanSensorFile(SensorAnalysis *analysis, int fd, int threads) {
+    struct stat info;
 
-    // Send required stats to print function
-    printData(outputFile, maxReading, maxTimestamp, minReading, minTimestamp,
-              numSensors, means, std_devs);
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        char *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED) {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            if ((size_t)info.st_size >= sizeof(ColumnFileHeader) &&
+                memcmp(data, COLUMN_FILE_MAGIC, 8) == 0) {
+                scanColumnFile(analysis, data, info.st_size);
+            } else {
+                scanSensorMapping(analysis, data, info.st_size, threads);
+            }
+            munmap(data, info.st_size);
+            return;
+        }
+    }
+    scanSensorStream(analysis, fd);
 }
 
 /**
- * @brief Validates if a string represents a valid sensor reading.
+ * @brief Parses sensor data from a file descriptor that cannot be memory-mapped.
  * 
- * This function checks if the input string is a valid sensor reading, defined as:
- * (May contain one '.', one 'e' or one 'E', one '+' or one '-')
+ * Data is read in large blocks. Complete lines are parsed straight out of the
+ * block, and a partial line at the end of a block is moved to the front of the
+ * buffer to be completed by the next read. The buffer grows as needed, so lines
+ * of any length are parsed whole. Lines are grouped into the same chunks as a
+ * memory-mapped file, so the result is the same as for a regular file. The
+ * chunks add their readings straight to the analysis's quantile sketches.
  * 
- * @param str The input string representing the sensor reading to be validated.
- * @return int Returns 1 if the string is a valid sensor reading, otherwise returns 0.
+ * @param analysis The analysis that the readings are added to.
+ * @param fd The file descriptor to read sensor data from.
  */
-int isValidSensorReading(char *str) {
-    int hasDigit = 0;
-    int hasEe = 0;
-    int hasDot = 0;
-    int i = 0;
+void scanSensorStream(SensorAnalysis *analysis, int fd) {
+    size_t capacity = READ_BLOCK_SIZE;
+    size_t length = 0;
+    size_t offset = 0;          // Position in the input of the start of the buffer
+    size_t chunkIndex = 0;      // Chunk of the input being parsed
+    char *data = malloc(capacity);
+    SensorAnalysis *chunk = malloc(sizeof(*chunk));
+    SensorBlock *block = newSensorBlock();
 
-    if (str[i] == '+' || str[i] == '-'){
-        i++;
+    if (data == NULL || chunk == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
     }
+    initChunkAnalysis(chunk, analysis->sketches);
 
-    while(str[i] != '\0' && str[i] != '\n') {
-        if(isdigit(str[i])) {
-            hasDigit = 1;
-        } 
-        
-        else if (str[i] == '.') {
-            if (hasDot || hasEe) {
-                return 0;
+    while (1) {
+        // Grow the buffer when a single line fills it
+        if (length == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            if (data == NULL) {
+                fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+                exit(1);
             }
-            hasDot = 1;
         }
 
-        else if (str[i] == 'e' || str[i] == 'E') {
-            if (hasEe || !hasDigit) {
-                return 0;
-            }
-            hasEe = 1;
-            i++;
-
-            if (str[i] == '+' || str[i] == '-'){
-                i++;
+        ssize_t count = read(fd, data + length, capacity - length);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
             }
-        if(!isdigit(str[i])) {
-            return 0;
+            snprintf(chunk->error, ERROR_BUFFER, "could not read sensor data");
+            break;
         }
+        if (count == 0) {
+            break;
         }
-        
-        else {
-            return 0;
-        }
+        length += count;
 
-    i++;
+        // Parse the complete lines and keep the partial one for the next read
+        size_t used = parseSensorChunks(analysis, chunk, block, &chunkIndex, offset, data, length, 0);
+        memmove(data, data + used, length - used);
+        length -= used;
+        offset += used;
+
+        // Stop reading once a line could not be parsed
+        if (chunk->error[0] != '\0' || analysis->error[0] != '\0') {
+            break;
+        }
     }
 
-return hasDigit;
+    if (chunk->error[0] == '\0') {
+        parseSensorChunks(analysis, chunk, block, &chunkIndex, offset, data, length, 1);
+    }
+    flushSensorBlock(chunk, block);
+    mergeChunkAnalysis(analysis, chunk);
+    free(block);
+    free(chunk);
+    free(data);
 }
 
 /**
- * @brief Calculates the mean and standard deviation for a set of sensor readings.
- * 
- * This function calculates the mean and standard deviation of the given sensor readings. 
- * If the count is 0, both the mean and standard deviation are set to 0. 
- * If there is only one reading, the standard deviation is also set to 0.
+ * @brief Parses lines read from a stream, merging each chunk when the next one starts.
  * 
- * @param readings Array of sensor readings.
- * @param count The number of sensor readings.
- * @param mean A pointer to the variable where the mean will be stored
- * @param std_dev A pointer to the variable where the standard deviation will be stored.
+ * @param analysis The analysis that finished chunks are merged into.
+ * @param chunk The partial result of the chunk being parsed.
+ * @param block The column block that lines of the chunk are parsed into.
+ * @param chunkIndex The index of the chunk being parsed, updated as chunks finish.
+ * @param offset The position in the input of the start of the buffer.
+ * @param data The start of the buffer.
+ * @param length The number of bytes in the buffer.
+ * @param final Nonzero if no more data follows.
+ * @return size_t The number of bytes parsed, which always ends on a line boundary.
  */
-void calcSensorStats(float readings[], int count, float *mean, float *std_dev) {
-    float sum_x = 0.0;  // Sum of all sensor readings
-    float sum_x2 = 0.0; // Sum of squared sensor readings
+size_t parseSensorChunks(SensorAnalysis *analysis, SensorAnalysis *chunk, SensorBlock *block,
+                         size_t *chunkIndex, size_t offset, const char *data, size_t length, int final) {
+    size_t used = 0;
 
-    // If there are no readings, mean and std dev are 0
-    if (count == 0) {
-        *mean = 0.0;
-        *std_dev = 0.0;
-        return;
-    }
+    while (1) {
+        size_t boundary = (*chunkIndex + 1) * CHUNK_SIZE - offset;
 
-    // Calculate sum and sum of squares for the readings
-    for(int i = 0; i < count; i++) {
-        sum_x += readings[i];
-        sum_x2 += readings[i] * readings[i];
-    }
+        used += parseSensorBuffer(chunk, block, data + used, length - used, boundary - used, final);
+        if (used < boundary) {
+            return used;
+        }
+
+        // The next line starts a new chunk
+        flushSensorBlock(chunk, block);
+        mergeChunkAnalysis(analysis, chunk);
+        initChunkAnalysis(chunk, analysis->sketches);
+        *chunkIndex = (offset + used) / CHUNK_SIZE;
+    }
+}
+
+/**
+ * @brief Parses a memory-mapped file on several threads.
+ * 
+ * Each chunk of the file is parsed into its own partial result, and the partial
+ * results are merged in file order. A chunk is always merged the same way no
+ * matter how many threads are used, so the output does not depend on the thread
+ * count, and the earliest timestamp still wins a tie for the maximum or minimum.
+ * 
+ * @param analysis The analysis that the readings are added to.
+ * @param data The start of the mapped file.
+ * @param length The size of the mapped file.
+ * @param maxThreads The most threads to parse on.
+ */
+void scanSensorMapping(SensorAnalysis *analysis, const char *data, size_t length, int maxThreads) {
+    SensorChunkJob job = {0};
+    size_t threadCount = maxThreads;
+
+    job.data = data;
+    job.length = length;
+    job.chunkCount = (length + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (threadCount > job.chunkCount) {
+        threadCount = job.chunkCount;
+    }
+    job.window = threadCount * 4;
+    job.sketches = analysis->sketches;
+    job.partials = malloc(job.window * sizeof(*job.partials));
+    job.ready = calloc(job.window, 1);
+    if (job.partials == NULL || job.ready == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    // A single thread parses and merges each chunk in turn
+    if (threadCount <= 1) {
+        SensorBlock *block = newSensorBlock();
+
+        for (size_t chunk = 0; chunk < job.chunkCount; chunk++) {
+            size_t start = findChunkStart(data, length, chunk);
+            size_t end = findChunkStart(data, length, chunk + 1);
+
+            parseSensorChunk(&job.partials[0], block, job.sketches, data + start, end - start);
+            mergeChunkAnalysis(analysis, &job.partials[0]);
+        }
+        free(block);
+        free(job.partials);
+        free(job.ready);
+        return;
+    }
+
+    pthread_t *threads = malloc(threadCount * sizeof(*threads));
+    if (threads == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    pthread_mutex_init(&job.sketchLock, NULL);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, scanSensorChunks, &job);
+    }
+
+    // Merge the partial results in file order as they are finished
+    while (job.mergedChunks < job.chunkCount) {
+        size_t slot = job.mergedChunks % job.window;
+
+        pthread_mutex_lock(&job.lock);
+        while (!job.ready[slot]) {
+            pthread_cond_wait(&job.changed, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        mergeSensorAnalysis(analysis, &job.partials[slot]);
+        freeSensorAnalysis(&job.partials[slot]);
+
+        pthread_mutex_lock(&job.lock);
+        job.ready[slot] = 0;
+        job.mergedChunks++;
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&job.sketchLock);
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.changed);
+    free(threads);
+    free(job.partials);
+    free(job.ready);
+}
+
+/**
+ * @brief Worker thread that parses chunks of a memory-mapped file.
+ * 
+ * A worker takes the next unparsed chunk as long as its partial result fits in
+ * the window of results that the main thread has not merged yet. With
+ * --quantiles, the worker's own sketches are merged into the job's and cleared
+ * after each chunk, so a worker holds one set of sketches however many of its
+ * partial results are waiting.
+ * 
+ * @param arg The SensorChunkJob shared by all workers.
+ * @return void* Always NULL.
+ */
+void *scanSensorChunks(void *arg) {
+    SensorChunkJob *job = arg;
+    SensorBlock *block = newSensorBlock();
+    QuantileSketch *sketches = NULL;
+
+    if (job->sketches != NULL) {
+        sketches = calloc(MAX_SENSORS, sizeof(QuantileSketch));
+        if (sketches == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+            exit(1);
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (1) {
+        while (job->nextChunk < job->chunkCount && job->nextChunk >= job->mergedChunks + job->window) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (job->nextChunk >= job->chunkCount) {
+            break;
+        }
+        size_t chunk = job->nextChunk++;
+        pthread_mutex_unlock(&job->lock);
+
+        size_t slot = chunk % job->window;
+        size_t start = findChunkStart(job->data, job->length, chunk);
+        size_t end = findChunkStart(job->data, job->length, chunk + 1);
+
+        SensorAnalysis *chunkResult = &job->partials[slot];
+        parseSensorChunk(chunkResult, block, sketches, job->data + start, end - start);
+        if (sketches != NULL) {
+            pthread_mutex_lock(&job->sketchLock);
+            for (int i = 0; i < chunkResult->expectedSensorCount; i++) {
+                mergeSketch(&job->sketches[i], &sketches[i]);
+            }
+            pthread_mutex_unlock(&job->sketchLock);
+            if (chunkResult->expectedSensorCount > 0) {
+                memset(sketches, 0, chunkResult->expectedSensorCount * sizeof(QuantileSketch));
+            }
+            chunkResult->sketches = NULL;
+        }
+
+        pthread_mutex_lock(&job->lock);
+        job->ready[slot] = 1;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    free(block);
+    free(sketches);
+    return NULL;
+}
+
+/**
+ * @brief Parses one whole chunk of a memory-mapped file into its own partial result.
+ * 
+ * @param chunk The partial result of the chunk, initialized here and freed after it is merged.
+ * @param block The column block that lines of the chunk are parsed into.
+ * @param sketches The sketches that the chunk's readings are added to, or NULL.
+ * @param data The first line of the chunk.
+ * @param length The size of the chunk.
+ */
+void parseSensorChunk(SensorAnalysis *chunk, SensorBlock *block, QuantileSketch *sketches,
+                      const char *data, size_t length) {
+    initChunkAnalysis(chunk, sketches);
+    parseSensorBuffer(chunk, block, data, length, length, 1);
+    flushSensorBlock(chunk, block);
+}
+
+/**
+ * @brief Finds where a chunk of the file starts.
+ * 
+ * Chunk n holds every line that starts in the n-th CHUNK_SIZE bytes of the file,
+ * so it starts at the first line boundary at or after n * CHUNK_SIZE.
+ * 
+ * @param data The start of the file.
+ * @param length The size of the file.
+ * @param chunk The index of the chunk.
+ * @return size_t The offset of the first line in the chunk, or length if there is none.
+ */
+size_t findChunkStart(const char *data, size_t length, size_t chunk) {
+    size_t position = chunk * CHUNK_SIZE;
+
+    if (position == 0) {
+        return 0;
+    }
+    if (position >= length) {
+        return length;
+    }
+
+    const char *newline = memchr(data + position - 1, '\n', length - position + 1);
+    return newline ? (size_t)(newline - data) + 1 : length;
+}
+
+/**
+ * @brief Parses every complete line in a buffer of sensor data.
+ * 
+ * Lines are parsed into the column block, whose statistics are added to the
+ * analysis each time it fills up. The caller flushes the last partial block.
+ * 
+ * @param analysis The analysis that the readings are added to.
+ * @param block The column block that lines are parsed into.
+ * @param data The start of the buffer.
+ * @param length The number of bytes in the buffer.
+ * @param limit Parsing stops at the first line that starts at or after this offset.
+ * @param final Nonzero if no more data follows, so a last line without a newline is parsed too.
+ * @return size_t The number of bytes parsed, which always ends on a line boundary. Parsing
+ * stops early at a line that cannot be parsed, whose error is recorded in the analysis.
+ */
+size_t parseSensorBuffer(SensorAnalysis *analysis, SensorBlock *block, const char *data,
+                         size_t length, size_t limit, int final) {
+    const char *position = data;
+    const char *end = data + length;
+
+    while (position < end && (size_t)(position - data) < limit) {
+        const char *newline = memchr(position, '\n', end - position);
+
+        if (newline == NULL) {
+            if (!final) {
+                break;
+            }
+            newline = end;
+        }
+        if (!parseSensorLine(analysis, block, position, newline)) {
+            break;
+        }
+        position = newline < end ? newline + 1 : end;
+    }
+    return position - data;
+}
+
+/**
+ * @brief Parses one line of sensor data in place into the next row of a column block.
+ * 
+ * When the block fills up, its statistics are added to the analysis.
+ * 
+ * @param analysis The analysis that the readings are added to.
+ * @param block The column block that the line is parsed into.
+ * @param line The first character of the line.
+ * @param end One past the last character of the line, not including the newline.
+ * @return int 1 if the line was parsed or blank, or 0 if it could not be parsed, in
+ * which case the error is recorded in the analysis.
+ */
+int parseSensorLine(SensorAnalysis *analysis, SensorBlock *block, const char *line, const char *end) {
+    int row = block->rows;
+    const char *timeStamp;
+    size_t timeStampLength;
+
+    int numSensors = parseSensorRow(line, end, &block->columns[0][row], BLOCK_ROWS,
+                                    &timeStamp, &timeStampLength, analysis->error);
+    if (numSensors == -1) {
+        return 1;
+    }
+    if (numSensors < 0) {
+        return 0;
+    }
+
+    // Check for consistent sensor readings
+    if (analysis->expectedSensorCount == -1) {
+        analysis->expectedSensorCount = numSensors;
+    } else if (numSensors != analysis->expectedSensorCount) {
+        snprintf(analysis->error, ERROR_BUFFER, "inconsistent sensor readings");
+        return 0;
+    }
+    copyTimestamp(block->timestamps[row], timeStamp, timeStampLength);
+    analysis->totalReadings++; // Increment number of readings processed
+
+    if (++block->rows == BLOCK_ROWS) {
+        flushSensorBlock(analysis, block);
+    }
+    return 1;
+}
+
+/**
+ * @brief Parses the timestamp and readings of one line of sensor data in place.
+ * 
+ * The first token of the line is the timestamp and the remaining tokens are
+ * sensor readings separated by spaces or tabs. The line is rejected if a
+ * reading is invalid or there are more than MAX_SENSORS of them.
+ * 
+ * @param line The first character of the line.
+ * @param end One past the last character of the line, not including the newline.
+ * @param readings Where the first reading is stored.
+ * @param stride The distance between where consecutive readings are stored.
+ * @param timeStamp Set to the first character of the timestamp.
+ * @param timeStampLength Set to the number of characters in the timestamp.
+ * @param error Set to why the line was rejected, in ERROR_BUFFER characters.
+ * @return int The number of readings on the line, -1 if the line is blank, or -2 if it was rejected.
+ */
+int parseSensorRow(const char *line, const char *end, float *readings, size_t stride,
+                   const char **timeStamp, size_t *timeStampLength, char *error) {
+    int numSensors = 0;
+
+    // Ignore a carriage return left by CRLF line endings
+    if (end > line && end[-1] == '\r') {
+        end--;
+    }
+
+    // Skip empty or whitespace-only lines
+    const char *position = skipBlanks(line, end);
+    if (position == end) {
+        return -1;
+    }
+
+    // Extract timestamp from first token in line
+    *timeStamp = position;
+    position = skipToken(position, end);
+    *timeStampLength = position - *timeStamp;
+
+    // Process sensor readings in a line
+    for (position = skipBlanks(position, end); position < end; position = skipBlanks(position, end)) {
+        const char *token = position;
+        position = skipToken(position, end);
+
+        if (numSensors >= MAX_SENSORS) { // Check for consistent amount of sensor readings
+            snprintf(error, ERROR_BUFFER, "inconsistent sensor readings");
+            return -2;
+        }
+
+        // Check and convert each sensor reading in a single pass
+        if (!parseSensorReading(token, position, &readings[numSensors * stride])) {
+            snprintf(error, ERROR_BUFFER, "Invalid sensor reading '%.*s'", (int)(position - token), token);
+            return -2;
+        }
+        numSensors++;
+    }
+    return numSensors;
+}
+
+/**
+ * @brief Allocates an empty column block.
+ * 
+ * @return SensorBlock* The new block. The program terminates if it cannot be allocated.
+ */
+SensorBlock *newSensorBlock(void) {
+    SensorBlock *block = aligned_alloc(64, sizeof(SensorBlock));
+
+    if (block == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    block->rows = 0;
+    block->writer = NULL;
+    return block;
+}
+
+/**
+ * @brief Adds the statistics of every row in a column block to the analysis and empties the block.
+ * 
+ * If the block has a column file writer, its rows are copied to the file first.
+ * 
+ * @param analysis The analysis that the block's statistics are added to.
+ * @param block The column block to flush.
+ */
+void flushSensorBlock(SensorAnalysis *analysis, SensorBlock *block) {
+    const float *columns[MAX_SENSORS];
+    int maxRow, minRow;
+
+    if (block->rows == 0) {
+        return;
+    }
+    if (block->writer != NULL) {
+        writeSensorBlock(block->writer, block, analysis->expectedSensorCount);
+    }
+
+    for (int i = 0; i < analysis->expectedSensorCount; i++) {
+        columns[i] = block->columns[i];
+    }
+    addColumnBlock(analysis, columns, block->rows, &maxRow, &minRow);
+
+    if (maxRow >= 0) {
+        strcpy(analysis->maxTimestamp, block->timestamps[maxRow]);
+    }
+    if (minRow >= 0) {
+        strcpy(analysis->minTimestamp, block->timestamps[minRow]);
+    }
+    block->rows = 0;
+}
+
+/**
+ * @brief Adds the statistics of a block of rows, given column by column, to the analysis.
+ * 
+ * Each column's sum, sum of squared deviations from the block mean, and extremes
+ * are taken with the selected vector kernels. The block's statistics are merged
+ * into the running statistics with the pairwise Welford update. The maximum and
+ * minimum keep the first row and the first sensor they occur at, the same as
+ * checking each reading in the order it was read. The caller stores the
+ * timestamp of a new maximum or minimum.
+ * 
+ * @param analysis The analysis that the block's statistics are added to.
+ * @param columns The readings of each sensor in the block.
+ * @param rows The number of rows in the block.
+ * @param maxRow Set to the row of a new maximum reading, or -1 if the maximum did not change.
+ * @param minRow Set to the row of a new minimum reading, or -1 if the minimum did not change.
+ */
+void addColumnBlock(SensorAnalysis *analysis, const float *const columns[], int rows,
+                    int *maxRow, int *minRow) {
+    float maxReading = -INFINITY;
+    float minReading = INFINITY;
+    int bestMaxRow = -1;
+    int bestMinRow = -1;
+    SensorStats parts[MAX_SENSORS];
+
+    for (int i = 0; i < analysis->expectedSensorCount; i++) {
+        parts[i].count = rows;
+        parts[i].mean = columnKernels->sum(columns[i], rows) / rows;
+        parts[i].m2 = columnKernels->squaredDeviations(columns[i], rows, parts[i].mean);
+    }
+    if (analysis->comoments != NULL) {
+        addColumnComoments(analysis, columns, rows, parts);
+    }
+
+    for (int i = 0; i < analysis->expectedSensorCount; i++) {
+        ColumnExtremes extremes;
+
+        mergeSensorStats(&analysis->stats[i], &parts[i]);
+        if (analysis->sketches != NULL) {
+            addToSketch(&analysis->sketches[i], columns[i], rows);
+        }
+
+        // Earlier rows win ties, and earlier sensors win ties on the same row
+        columnKernels->extremes(columns[i], rows, &extremes);
+        if (extremes.max > maxReading || (extremes.max == maxReading && extremes.maxRow < bestMaxRow)) {
+            maxReading = extremes.max;
+            bestMaxRow = extremes.maxRow;
+        }
+        if (extremes.min < minReading || (extremes.min == minReading && extremes.minRow < bestMinRow)) {
+            minReading = extremes.min;
+            bestMinRow = extremes.minRow;
+        }
+    }
+
+    *maxRow = *minRow = -1;
+    if (bestMaxRow >= 0 && maxReading > analysis->maxReading) {
+        analysis->maxReading = maxReading;
+        *maxRow = bestMaxRow;
+    }
+    if (bestMinRow >= 0 && minReading < analysis->minReading) {
+        analysis->minReading = minReading;
+        *minRow = bestMinRow;
+    }
+}
+
+/**
+ * @brief Analyzes a memory-mapped column file without parsing any text.
+ * 
+ * The columns are read in SEGMENT_ROWS pieces straight from the mapping with the
+ * same kernels used for parsed text. An error is recorded in the analysis if the
+ * header does not describe a column file that this program can read.
+ * 
+ * @param analysis The analysis that the readings are added to.
+ * @param data The start of the mapped file.
+ * @param length The size of the mapped file.
+ */
+void scanColumnFile(SensorAnalysis *analysis, const char *data, size_t length) {
+    ColumnFileHeader header;
+    const float *columns[MAX_SENSORS];
+    int maxRow, minRow;
+
+    memcpy(&header, data, sizeof(header));
+    if (!columnFileFits(&header, length)) {
+        snprintf(analysis->error, ERROR_BUFFER, "unreadable column file");
+        return;
+    }
+    if (header.rowCount == 0) {
+        return;
+    }
+
+    analysis->expectedSensorCount = header.sensorCount;
+    analysis->totalReadings = header.rowCount;
+    const char *timestamps = data + header.timestampOffset;
+    const float *firstColumn = (const float *)(data + header.columnOffset);
+
+    for (uint64_t row = 0; row < header.rowCount; row += SEGMENT_ROWS) {
+        uint64_t remaining = header.rowCount - row;
+        int rows = remaining < SEGMENT_ROWS ? remaining : SEGMENT_ROWS;
+
+        for (uint32_t i = 0; i < header.sensorCount; i++) {
+            columns[i] = firstColumn + i * header.rowCount + row;
+        }
+        addColumnBlock(analysis, columns, rows, &maxRow, &minRow);
+
+        if (maxRow >= 0) {
+            const char *timeStamp = timestamps + (row + maxRow) * header.timestampWidth;
+            copyTimestamp(analysis->maxTimestamp, timeStamp, strnlen(timeStamp, header.timestampWidth));
+        }
+        if (minRow >= 0) {
+            const char *timeStamp = timestamps + (row + minRow) * header.timestampWidth;
+            copyTimestamp(analysis->minTimestamp, timeStamp, strnlen(timeStamp, header.timestampWidth));
+        }
+    }
+}
+
+/**
+ * @brief Checks that the columns a column file header describes lie within the file.
+ * 
+ * Every field comes from the file, so each product and sum is checked for
+ * overflow; a header that would wrap around is rejected rather than allowed to
+ * point past the mapping.
+ * 
+ * @param header The header read from the start of the file.
+ * @param length The size of the file.
+ * @return int 1 if the file can be read, 0 otherwise.
+ */
+int columnFileFits(const ColumnFileHeader *header, size_t length) {
+    uint64_t timestampBytes, timestampEnd, columnBytes, sensorBytes, columnEnd;
+
+    if (header->version != COLUMN_FILE_VERSION || header->sensorCount > MAX_SENSORS ||
+        (header->sensorCount == 0 && header->rowCount > 0) || header->timestampWidth == 0 ||
+        header->columnOffset % sizeof(float) != 0) {
+        return 0;
+    }
+    if (__builtin_mul_overflow(header->rowCount, (uint64_t)header->timestampWidth, &timestampBytes) ||
+        __builtin_add_overflow(header->timestampOffset, timestampBytes, &timestampEnd) ||
+        __builtin_mul_overflow(header->rowCount, (uint64_t)sizeof(float), &columnBytes) ||
+        __builtin_mul_overflow(columnBytes, (uint64_t)header->sensorCount, &sensorBytes) ||
+        __builtin_add_overflow(header->columnOffset, sensorBytes, &columnEnd)) {
+        return 0;
+    }
+    return timestampEnd <= length && columnEnd <= length;
+}
+
+/**
+ * @brief Converts a text sensor file into a column file.
+ * 
+ * The text file is scanned once to count its rows so that the column file can be
+ * sized and memory-mapped up front. It is then parsed as usual, and every column
+ * block is copied into the mapped file as it is flushed. The input must be a
+ * regular file. The program terminates on any error.
+ * 
+ * @param inputName The text sensor file to convert.
+ * @param outputName The column file to create.
+ */
+void convertSensorFile(char *inputName, char *outputName) {
+    FILE *inputFile = openFile(inputName);
+    struct stat info;
+    int sensorCount = 0;
+
+    if (fstat(fileno(inputFile), &info) == 0 && S_ISFIFO(info.st_mode)) {
+        fprintf(stderr, "Warning: Terminating program (this needs an uncompressed sensor file).\n");
+        exit(1);
+    }
+    if (fstat(fileno(inputFile), &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        fprintf(stderr, "Warning: Terminating program (no sensor data to process).\n");
+        exit(1);
+    }
+    char *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(inputFile), 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map file '%s'.\n", inputName);
+        exit(1);
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    // Lay out the column file
+    ColumnFileHeader header = {0};
+    memcpy(header.magic, COLUMN_FILE_MAGIC, 8);
+    header.version = COLUMN_FILE_VERSION;
+    header.rowCount = countSensorLines(data, info.st_size, &sensorCount);
+    header.sensorCount = sensorCount;
+    header.timestampWidth = BUFFER;
+    header.timestampOffset = sizeof(header);
+    header.columnOffset = (header.timestampOffset + header.rowCount * BUFFER + 63) & ~(uint64_t)63;
+    size_t outputSize = header.columnOffset + header.rowCount * sensorCount * sizeof(float);
+
+    int fd = open(outputName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, outputSize) != 0) {
+        fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", outputName);
+        exit(1);
+    }
+    char *output = mmap(NULL, outputSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (output == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map file '%s'.\n", outputName);
+        exit(1);
+    }
+    memcpy(output, &header, sizeof(header));
+
+    // Parse the text, copying each column block into the file
+    ColumnFileWriter writer = {
+        output + header.timestampOffset, (float *)(output + header.columnOffset), header.rowCount, 0
+    };
+    SensorAnalysis analysis;
+    SensorBlock *block = newSensorBlock();
+
+    block->writer = &writer;
+    initSensorAnalysis(&analysis);
+    parseSensorBuffer(&analysis, block, data, info.st_size, info.st_size, 1);
+    flushSensorBlock(&analysis, block);
+    checkSensorAnalysis(&analysis);
+    freeSensorAnalysis(&analysis);
+
+    printf("Converted %llu rows of %d sensors into '%s' (%zu bytes).\n",
+           (unsigned long long)header.rowCount, sensorCount, outputName, outputSize);
+
+    free(block);
+    munmap(output, outputSize);
+    close(fd);
+    munmap(data, info.st_size);
+    fclose(inputFile);
+}
+
+/**
+ * @brief Counts the lines of a text sensor file that hold data.
+ * 
+ * @param data The start of the file.
+ * @param length The size of the file.
+ * @param sensorCount Set to the number of readings on the first data line.
+ * @return size_t The number of lines that are not empty or whitespace-only.
+ */
+size_t countSensorLines(const char *data, size_t length, int *sensorCount) {
+    const char *position = data;
+    const char *end = data + length;
+    size_t lines = 0;
+
+    *sensorCount = 0;
+    while (position < end) {
+        const char *newline = memchr(position, '\n', end - position);
+        const char *lineEnd = newline ? newline : end;
+        const char *token = skipBlanks(position, lineEnd);
+
+        if (token < lineEnd && !(lineEnd - token == 1 && *token == '\r')) {
+            // The readings on the first line set the column count
+            if (lines++ == 0) {
+                for (token = skipBlanks(skipToken(token, lineEnd), lineEnd); token < lineEnd;
+                     token = skipBlanks(skipToken(token, lineEnd), lineEnd)) {
+                    if (!(lineEnd - token == 1 && *token == '\r')) {
+                        (*sensorCount)++;
+                    }
+                }
+            }
+        }
+        position = lineEnd + 1;
+    }
+    return lines;
+}
+
+/**
+ * @brief Copies the rows of a column block into a column file.
+ * 
+ * @param writer The column file being written.
+ * @param block The column block to copy.
+ * @param sensorCount The number of sensors in each row.
+ */
+void writeSensorBlock(ColumnFileWriter *writer, const SensorBlock *block, int sensorCount) {
+    if (writer->rowsWritten + block->rows > writer->rowCount) {
+        fprintf(stderr, "Warning: Terminating program (sensor file changed while converting).\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < block->rows; i++) {
+        strncpy(writer->timestamps + (writer->rowsWritten + i) * BUFFER, block->timestamps[i], BUFFER);
+    }
+    for (int i = 0; i < sensorCount; i++) {
+        memcpy(writer->columns + i * writer->rowCount + writer->rowsWritten,
+               block->columns[i], block->rows * sizeof(float));
+    }
+    writer->rowsWritten += block->rows;
+}
+
+/**
+ * @brief Skips the spaces and tabs that separate tokens.
+ * 
+ * @param position The current position in the line.
+ * @param end One past the last character of the line.
+ * @return const char* The first character that is not a space or tab, or end.
+ */
+const char *skipBlanks(const char *position, const char *end) {
+    while (position < end && (*position == ' ' || *position == '\t')) {
+        position++;
+    }
+    return position;
+}
+
+/**
+ * @brief Skips over the current token.
+ * 
+ * @param position The first character of the token.
+ * @param end One past the last character of the line.
+ * @return const char* The space or tab that ends the token, or end.
+ */
+const char *skipToken(const char *position, const char *end) {
+    while (position < end && *position != ' ' && *position != '\t') {
+        position++;
+    }
+    return position;
+}
+
+/**
+ * @brief Copies a timestamp out of a line, truncating it to fit the buffer.
+ * 
+ * @param dest Buffer of BUFFER characters that receives the timestamp.
+ * @param timeStamp The first character of the timestamp.
+ * @param length The number of characters in the timestamp.
+ */
+void copyTimestamp(char *dest, const char *timeStamp, size_t length) {
+    if (length > BUFFER - 1) {
+        length = BUFFER - 1;
+    }
+    memcpy(dest, timeStamp, length);
+    dest[length] = '\0';
+}
+
+/**
+ * @brief Writes the results of a sensor analysis to the output file.
+ * 
+ * The program terminates if no sensor data was parsed.
+ * 
+ * @param analysis The analysis to report.
+ * @param outputFile The file where the processed data is written.
+ */
+void reportSensorAnalysis(const SensorAnalysis *analysis, FILE *outputFile) {
+    int numSensors = analysis->expectedSensorCount;
+
+    if (analysis->totalReadings == 0) {
+        fprintf(stderr, "Warning: Terminating program (no sensor data to process).\n");
+        exit(1);
+    }
+
+    // Arrays to store mean and standard deviation for each sensor
+    float means[MAX_SENSORS];
+    float std_devs[MAX_SENSORS];
+
+    // Finish the running stats for each sensor
+    for (int i = 0; i < numSensors; i++) {
+        finishSensorStats(&analysis->stats[i], &means[i], &std_devs[i]);
+    }
+
+    // Percentiles come from the sketches, or were kept when the sketches were let go
+    double percentiles[MAX_SENSORS][3];
+    double (*shown)[3] = analysis->percentiles;
+    if (analysis->sketches != NULL) {
+        findPercentiles(analysis->sketches, numSensors, percentiles);
+        shown = percentiles;
+    }
+
+    // Send required stats to print function
+    printData(outputFile, analysis->maxReading, (char *)analysis->maxTimestamp,
+              analysis->minReading, (char *)analysis->minTimestamp,
+              numSensors, means, std_devs, shown);
+    if (analysis->comoments != NULL) {
+        printCorrelation(outputFile, analysis);
+    }
+}
+
+/**
+ * @brief Analyzes many sensor files on a pool of worker threads.
+ * 
+ * Workers take the files in order and analyze each one on a single thread.
+ * The main thread prints each file's report and merges it into a combined
+ * analysis in the order the files were given, so the output is the same no
+ * matter which worker finishes first. Only a window of finished analyses is
+ * held at once. The combined report follows the per-file reports, and the
+ * overall throughput is printed to stderr.
+ * 
+ * A file that cannot be opened or decoded, or whose lines hold a different
+ * number of readings than the files before it, is left out of the combined
+ * report and named as skipped, and the rest of the batch goes on.
+ * 
+ * @param names The sensor files to analyze.
+ * @param fileCount The number of sensor files.
+ * @param outputFile The file where the reports are written.
+ * @return size_t The number of files skipped.
+ */
+size_t analyzeSensorBatch(char **names, size_t fileCount, FILE *outputFile) {
+    SensorBatchJob job = {0};
+    SensorAnalysis total;
+    size_t threadCount = (size_t)options.threads < fileCount ? (size_t)options.threads : fileCount;
+    size_t skipped = 0;
+    double bytes = 0;
+
+    if (fileCount == 0) {
+        fprintf(stderr, "Warning: Terminating program (no sensor files to analyze).\n");
+        exit(1);
+    }
+
+    job.names = names;
+    job.fileCount = fileCount;
+    job.window = threadCount * 4;
+    job.results = malloc(job.window * sizeof(*job.results));
+    job.sizes = malloc(job.window * sizeof(*job.sizes));
+    job.errors = malloc(job.window * sizeof(*job.errors));
+    job.ready = calloc(job.window, 1);
+    pthread_t *threads = malloc(threadCount * sizeof(*threads));
+    if (job.results == NULL || job.sizes == NULL || job.errors == NULL || job.ready == NULL || threads == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    initSensorAnalysis(&total);
+    double start = currentSeconds();
+    pthread_mutex_init(&job.sketchLock, NULL);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, analyzeBatchFiles, &job);
+    }
+
+    // Report and merge the files in the order they were given
+    while (job.reportedFiles < fileCount) {
+        size_t slot = job.reportedFiles % job.window;
+
+        pthread_mutex_lock(&job.lock);
+        while (!job.ready[slot]) {
+            pthread_cond_wait(&job.changed, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        SensorAnalysis *result = &job.results[slot];
+        const char *error = job.errors[slot];
+
+        // Files with a different number of sensors cannot join the combined report
+        if (error == NULL && result->totalReadings > 0 && total.expectedSensorCount != -1 &&
+            result->expectedSensorCount != total.expectedSensorCount) {
+            error = "different number of sensors";
+        }
+
+        fprintf(outputFile, "File: %s\n", names[job.reportedFiles]);
+        if (job.errors[slot] != NULL) {
+            fprintf(outputFile, "Skipped (%s).\n", error);
+        } else if (result->totalReadings == 0) {
+            fprintf(outputFile, "No sensor data.\n");
+        } else {
+            reportSensorAnalysis(result, outputFile);
+            if (error != NULL) {
+                fprintf(outputFile, "Skipped from the combined report (%d sensors, not %d).\n",
+                        result->expectedSensorCount, total.expectedSensorCount);
+            }
+        }
+        fprintf(outputFile, "\n");
+        if (error == NULL) {
+            mergeSensorAnalysis(&total, result);
+            bytes += job.sizes[slot];
+        } else {
+            fprintf(stderr, "Warning: Skipping file '%s' (%s).\n", names[job.reportedFiles], error);
+            skipped++;
+        }
+        freeSensorAnalysis(result);
+
+        pthread_mutex_lock(&job.lock);
+        job.ready[slot] = 0;
+        job.reportedFiles++;
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = currentSeconds() - start;
+
+    // The files merged into the total are the ones with its number of sensors
+    if (total.sketches != NULL && total.expectedSensorCount > 0 &&
+        job.countSketches[total.expectedSensorCount] != NULL) {
+        for (int i = 0; i < total.expectedSensorCount; i++) {
+            mergeSketch(&total.sketches[i], &job.countSketches[total.expectedSensorCount][i]);
+        }
+    }
+
+    if (skipped > 0) {
+        fprintf(outputFile, "All %zu files except the %zu skipped:\n", fileCount - skipped, skipped);
+    } else {
+        fprintf(outputFile, "All %zu files:\n", fileCount);
+    }
+    if (total.totalReadings == 0) {
+        fprintf(outputFile, "No sensor data.\n");
+    } else {
+        reportSensorAnalysis(&total, outputFile);
+    }
+    fprintf(stderr, "Analyzed %zu files (%.1f MB) in %.3f s on %zu threads: %.1f files/s, %.1f MB/s\n",
+            fileCount - skipped, bytes / 1e6, elapsed, threadCount, (fileCount - skipped) / elapsed,
+            bytes / 1e6 / elapsed);
+
+    pthread_mutex_destroy(&job.sketchLock);
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.changed);
+    for (int i = 0; i <= MAX_SENSORS; i++) {
+        free(job.countSketches[i]);
+    }
+    freeSensorAnalysis(&total);
+    free(threads);
+    free(job.results);
+    free(job.sizes);
+    free(job.errors);
+    free(job.ready);
+    return skipped;
+}
+
+/**
+ * @brief Worker thread that analyzes files of a batch.
+ * 
+ * A worker takes the next file as long as its result fits in the window of
+ * results that the main thread has not reported yet.
+ * 
+ * @param arg The SensorBatchJob shared by all workers.
+ * @return void* Always NULL.
+ */
+void *analyzeBatchFiles(void *arg) {
+    SensorBatchJob *job = arg;
+    QuantileSketch *sketches = NULL;
+
+    if (options.quantiles) {
+        sketches = calloc(MAX_SENSORS, sizeof(QuantileSketch));
+        if (sketches == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+            exit(1);
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (1) {
+        while (job->nextFile < job->fileCount && job->nextFile >= job->reportedFiles + job->window) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (job->nextFile >= job->fileCount) {
+            break;
+        }
+        size_t file = job->nextFile++;
+        pthread_mutex_unlock(&job->lock);
+
+        size_t slot = file % job->window;
+        struct stat info;
+        int fd = open(job->names[file], O_RDONLY);
+        int textFd = -1;
+
+        initChunkAnalysis(&job->results[slot], sketches);
+        job->sizes[slot] = 0;
+        job->errors[slot] = NULL;
+        if (fd < 0) {
+            job->errors[slot] = "could not open file";
+        } else {
+            // Compressed files are decoded on one thread, as the files already run in parallel
+            textFd = openDecompressed(fd, job->names[file], 1);
+            if (textFd < 0) {
+                job->errors[slot] = "could not decompress file";
+            }
+        }
+        if (textFd >= 0) {
+            scanSensorFile(&job->results[slot], textFd, 1);
+            if (job->results[slot].error[0] != '\0') {
+                job->errors[slot] = job->results[slot].error;
+            }
+            job->sizes[slot] = fstat(fd, &info) == 0 ? info.st_size : 0;
+            if (textFd != fd) {
+                close(textFd);
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (sketches != NULL) {
+            keepBatchSketches(job, &job->results[slot], job->errors[slot] == NULL);
+        }
+
+        pthread_mutex_lock(&job->lock);
+        job->ready[slot] = 1;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    free(sketches);
+    return NULL;
+}
+
+/**
+ * @brief Keeps a batch file's percentiles and lets go of the worker's sketches.
+ * 
+ * The percentiles of the file are kept in its result for its report. The
+ * sketches are added to the job's combined sketches for the file's number of
+ * sensors, unless the file is left out, and then cleared for the next file.
+ * 
+ * @param job The SensorBatchJob shared by all workers.
+ * @param result The result of the file, whose sketches belong to the worker.
+ * @param merge Nonzero to add the file to the combined sketches.
+ */
+void keepBatchSketches(SensorBatchJob *job, SensorAnalysis *result, int merge) {
+    int sensors = result->expectedSensorCount;
+
+    if (result->totalReadings > 0 && sensors > 0) {
+        result->percentiles = malloc(sensors * sizeof(*result->percentiles));
+        if (result->percentiles == NULL) {
+            fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+            exit(1);
+        }
+        findPercentiles(result->sketches, sensors, result->percentiles);
+
+        if (merge) {
+            pthread_mutex_lock(&job->sketchLock);
+            if (job->countSketches[sensors] == NULL) {
+                job->countSketches[sensors] = calloc(sensors, sizeof(QuantileSketch));
+                if (job->countSketches[sensors] == NULL) {
+                    fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+                    exit(1);
+                }
+            }
+            for (int i = 0; i < sensors; i++) {
+                mergeSketch(&job->countSketches[sensors][i], &result->sketches[i]);
+            }
+            pthread_mutex_unlock(&job->sketchLock);
+        }
+    }
+    if (sensors > 0) {
+        memset(result->sketches, 0, sensors * sizeof(QuantileSketch));
+    }
+    result->sketches = NULL;
+}
+
+/**
+ * @brief Builds the list of files for a batch from the command line.
+ * 
+ * Each argument is either a sensor file or a directory, which adds the regular
+ * files directly inside it in name order, skipping hidden ones. A list file, if
+ * given, adds one file name per line after the arguments.
+ * 
+ * @param arguments The file and directory names from the command line.
+ * @param argumentCount The number of names.
+ * @param listFile A file with one sensor file name per line, or NULL.
+ * @param fileCount Set to the number of files in the list.
+ * @return char** The file names, each allocated with malloc, in the order they are reported.
+ */
+char **collectBatchFiles(char **arguments, int argumentCount, char *listFile, size_t *fileCount) {
+    size_t capacity = 64;
+    char **names = malloc(capacity * sizeof(*names));
+
+    *fileCount = 0;
+    for (int i = 0; i < argumentCount; i++) {
+        struct stat info;
+        struct dirent **entries;
+
+        if (stat(arguments[i], &info) != 0 || !S_ISDIR(info.st_mode)) {
+            names = addBatchFile(names, fileCount, &capacity, strdup(arguments[i]));
+            continue;
+        }
+
+        int entryCount = scandir(arguments[i], &entries, NULL, alphasort);
+        if (entryCount < 0) {
+            fprintf(stderr, "Error: Could not open directory '%s'. Please check file path.\n", arguments[i]);
+            exit(1);
+        }
+        for (int j = 0; j < entryCount; j++) {
+            char *path = malloc(strlen(arguments[i]) + strlen(entries[j]->d_name) + 2);
+
+            sprintf(path, "%s/%s", arguments[i], entries[j]->d_name);
+            if (entries[j]->d_name[0] != '.' && stat(path, &info) == 0 && S_ISREG(info.st_mode)) {
+                names = addBatchFile(names, fileCount, &capacity, path);
+            } else {
+                free(path);
+            }
+            free(entries[j]);
+        }
+        free(entries);
+    }
+
+    if (listFile != NULL) {
+        FILE *file = openFile(listFile);
+        char line[MAX_LINE_LENGTH];
+
+        while (fgets(line, sizeof(line), file) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0') {
+                names = addBatchFile(names, fileCount, &capacity, strdup(line));
+            }
+        }
+        fclose(file);
+    }
+    return names;
+}
+
+/**
+ * @brief Appends a file name to a batch, growing the list as needed.
+ * 
+ * @param names The list of file names.
+ * @param fileCount The number of names in the list, which is incremented.
+ * @param capacity The number of names the list can hold, which may be doubled.
+ * @param name The file name to append, allocated with malloc.
+ * @return char** The list, which may have moved.
+ */
+char **addBatchFile(char **names, size_t *fileCount, size_t *capacity, char *name) {
+    if (*fileCount == *capacity) {
+        *capacity *= 2;
+        names = realloc(names, *capacity * sizeof(*names));
+    }
+    if (names == NULL || name == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    names[(*fileCount)++] = name;
+    return names;
+}
+
+/**
+ * @brief Reads a fixed number of decimal digits.
+ * 
+ * @param position The first digit.
+ * @param end One past the last character that may be read.
+ * @param count The number of digits to read.
+ * @param value Set to the value of the digits.
+ * @return int 1 if there were count digits, 0 otherwise.
+ */
+int parseDigits(const char *position, const char *end, int count, int *value) {
+    if (end - position < count) {
+        return 0;
+    }
+
+    *value = 0;
+    for (int i = 0; i < count; i++) {
+        if (position[i] < '0' || position[i] > '9') {
+            return 0;
+        }
+        *value = *value * 10 + (position[i] - '0');
+    }
+    return 1;
+}
+
+/**
+ * @brief Counts the days from 1970-01-01 to a date in the proleptic Gregorian calendar.
+ * 
+ * @param year The year.
+ * @param month The month, from 1 to 12.
+ * @param day The day of the month, from 1 to 31.
+ * @return int64_t The number of days, negative before 1970.
+ */
+int64_t daysFromCivil(int year, int month, int day) {
+    // Count years from March, so that the leap day is the last day of the year
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * @brief Gives the number of days in a month of the proleptic Gregorian calendar.
+ * 
+ * @param year The year.
+ * @param month The month, from 1 to 12.
+ * @return int The number of days, from 28 to 31.
+ */
+int daysInMonth(int year, int month) {
+    static const int lengths[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+
+    return lengths[month - 1] + (month == 2 && leap);
+}
+
+/**
+ * @brief Converts a timestamp into seconds since the epoch.
+ * 
+ * Three forms are recognized:
+ *   YYYY-MM-DDTHH:MM:SS[.fff][Z|+HH:MM|-HH:MM], or just YYYY-MM-DD, in UTC
+ *   unless an offset is given.
+ *   HH:MM:SS[.fff], as seconds since midnight.
+ *   A plain number of seconds since the epoch, such as 1732320000[.fff].
+ * Fractions of a second are dropped.
+ * 
+ * @param start The first character of the timestamp.
+ * @param length The number of characters in the timestamp.
+ * @param epoch Set to the number of seconds.
+ * @return int 1 if the timestamp is valid, 0 otherwise.
+ */
+int parseTimestamp(const char *start, size_t length, int64_t *epoch) {
+    const char *position = start;
+    const char *end = start + length;
+    int year, month, day, hour, minute, second;
+    int64_t days = 0;
+    int64_t offset = 0;
+
+    if (length >= 10 && start[4] == '-') {
+        // Calendar date, optionally followed by a time of day
+        if (!parseDigits(position, end, 4, &year) || !parseDigits(position + 5, end, 2, &month) ||
+            position[7] != '-' || !parseDigits(position + 8, end, 2, &day) ||
+            month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+            return 0;
+        }
+        days = daysFromCivil(year, month, day);
+        position += 10;
+        if (position == end) {
+            *epoch = days * 86400;
+            return 1;
+        }
+        if (*position++ != 'T') {
+            return 0;
+        }
+    } else if (length < 8 || start[2] != ':') {
+        // Seconds since the epoch
+        int64_t value = 0;
+
+        while (position < end && *position >= '0' && *position <= '9') {
+            value = value * 10 + (*position++ - '0');
+        }
+        if (position == start) {
+            return 0;
+        }
+        if (position < end && *position == '.') {
+            for (position++; position < end && *position >= '0' && *position <= '9'; position++);
+        }
+        *epoch = value;
+        return position == end;
+    }
+
+    // Time of day
+    if (end - position < 8 || !parseDigits(position, end, 2, &hour) || position[2] != ':' ||
+        !parseDigits(position + 3, end, 2, &minute) || position[5] != ':' ||
+        !parseDigits(position + 6, end, 2, &second) || hour > 23 || minute > 59 || second > 60) {
+        return 0;
+    }
+    position += 8;
+    if (position < end && *position == '.') {
+        for (position++; position < end && *position >= '0' && *position <= '9'; position++);
+    }
+
+    // Time zone, where local time is UTC plus the offset
+    if (position < end && *position == 'Z') {
+        position++;
+    } else if (position < end && (*position == '+' || *position == '-')) {
+        int offsetHours, offsetMinutes;
+
+        if (end - position < 6 || !parseDigits(position + 1, end, 2, &offsetHours) ||
+            position[3] != ':' || !parseDigits(position + 4, end, 2, &offsetMinutes)) {
+            return 0;
+        }
+        offset = (offsetHours * 60 + offsetMinutes) * 60;
+        if (*position == '+') {
+            offset = -offset;
+        }
+        position += 6;
+    }
+    if (position != end) {
+        return 0;
+    }
+
+    *epoch = days * 86400 + hour * 3600 + minute * 60 + second + offset;
+    return 1;
+}
+
+/**
+ * @brief Reads the timestamp at the start of a line.
+ * 
+ * The program terminates if the line holds data but its timestamp is not valid.
+ * 
+ * @param line The first character of the line.
+ * @param end One past the last character of the line, not counting the newline.
+ * @param epoch Set to the timestamp in seconds since the epoch.
+ * @return int 1 if the line holds data, 0 if it is blank.
+ */
+int lineTimestamp(const char *line, const char *end, int64_t *epoch) {
+    if (end > line && end[-1] == '\r') {
+        end--;
+    }
+
+    const char *start = skipBlanks(line, end);
+    const char *stop = skipToken(start, end);
+
+    if (start == end) {
+        return 0;
+    }
+    if (!parseTimestamp(start, stop - start, epoch)) {
+        fprintf(stderr, "Warning: Terminating program (invalid timestamp '%.*s').\n", (int)(stop - start), start);
+        exit(1);
+    }
+    return 1;
+}
+
+/**
+ * @brief Builds the time index of a text sensor file.
+ * 
+ * An entry is made for the first line of each bucket of bucketSeconds seconds
+ * that holds any lines. The program terminates if the timestamps are not in order.
+ * 
+ * @param data The start of the file.
+ * @param length The size of the file.
+ * @param bucketSeconds The length of each bucket in seconds.
+ * @param entryCount Set to the number of entries.
+ * @return TimeIndexEntry* The entries, allocated with malloc, in file order.
+ */
+TimeIndexEntry *buildTimeIndex(const char *data, size_t length, int64_t bucketSeconds, size_t *entryCount) {
+    size_t capacity = 1024;
+    TimeIndexEntry *entries = malloc(capacity * sizeof(*entries));
+    const char *position = data;
+    const char *end = data + length;
+    int64_t lastTime = INT64_MIN;
+    int64_t lastBucket = 0;
+
+    *entryCount = 0;
+    while (position < end) {
+        const char *newline = memchr(position, '\n', end - position);
+        const char *lineEnd = newline != NULL ? newline : end;
+        int64_t time;
+
+        if (lineTimestamp(position, lineEnd, &time)) {
+            if (time < lastTime) {
+                fprintf(stderr, "Warning: Terminating program (timestamps out of order, cannot index).\n");
+                exit(1);
+            }
+
+            // Round down, so that times before 1970 land in the right bucket
+            int64_t bucket = time / bucketSeconds - (time % bucketSeconds < 0);
+
+            if (*entryCount == 0 || bucket != lastBucket) {
+                if (*entryCount == capacity) {
+                    capacity *= 2;
+                    entries = realloc(entries, capacity * sizeof(*entries));
+                }
+                if (entries == NULL) {
+                    fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+                    exit(1);
+                }
+                entries[*entryCount].time = time;
+                entries[*entryCount].offset = position - data;
+                (*entryCount)++;
+                lastBucket = bucket;
+            }
+            lastTime = time;
+        }
+        position = newline != NULL ? newline + 1 : end;
+    }
+    return entries;
+}
+
+/**
+ * @brief Loads the time index of a sensor file from its side file.
+ * 
+ * @param indexName The index file to load.
+ * @param info The status of the sensor file, to check that the index is current.
+ * @param entryCount Set to the number of entries.
+ * @return TimeIndexEntry* The entries, allocated with malloc, or NULL if there is
+ * no index or it was made for an older version of the sensor file.
+ */
+TimeIndexEntry *loadTimeIndex(char *indexName, const struct stat *info, size_t *entryCount) {
+    FILE *file = fopen(indexName, "rb");
+    TimeIndexHeader header;
+    TimeIndexEntry *entries = NULL;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(header.magic, TIME_INDEX_MAGIC, 8) == 0 && header.version == TIME_INDEX_VERSION &&
+        header.fileSize == (uint64_t)info->st_size && header.fileModified == (int64_t)info->st_mtime &&
+        header.entryCount > 0) {
+        entries = malloc(header.entryCount * sizeof(*entries));
+        if (entries != NULL && fread(entries, sizeof(*entries), header.entryCount, file) == header.entryCount) {
+            *entryCount = header.entryCount;
+        } else {
+            free(entries);
+            entries = NULL;
+        }
+    }
+    fclose(file);
+    return entries;
+}
+
+/**
+ * @brief Saves the time index of a sensor file to its side file.
+ * 
+ * @param indexName The index file to create.
+ * @param info The status of the sensor file, recorded to tell when the index is out of date.
+ * @param entries The entries of the index.
+ * @param entryCount The number of entries.
+ * @return int 1 if the index was saved, 0 otherwise.
+ */
+int saveTimeIndex(char *indexName, const struct stat *info, const TimeIndexEntry *entries, size_t entryCount) {
+    FILE *file = fopen(indexName, "wb");
+    TimeIndexHeader header = {0};
+
+    if (file == NULL) {
+        return 0;
+    }
+    memcpy(header.magic, TIME_INDEX_MAGIC, 8);
+    header.version = TIME_INDEX_VERSION;
+    header.bucketSeconds = options.indexBucket;
+    header.entryCount = entryCount;
+    header.fileSize = info->st_size;
+    header.fileModified = info->st_mtime;
+
+    int saved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                fwrite(entries, sizeof(*entries), entryCount, file) == entryCount;
+    return fclose(file) == 0 && saved;
+}
+
+/**
+ * @brief Finds the first line at or after a time.
+ * 
+ * The index narrows the search down to one bucket, and only the lines of that
+ * bucket are read.
+ * 
+ * @param data The start of the file.
+ * @param length The size of the file.
+ * @param entries The time index of the file.
+ * @param entryCount The number of entries in the index.
+ * @param time The time to look for, in seconds since the epoch.
+ * @param after Nonzero to find the first line strictly after the time.
+ * @return size_t The offset of the line, or length if there is none.
+ */
+size_t findTimeOffset(const char *data, size_t length, const TimeIndexEntry *entries,
+                      size_t entryCount, int64_t time, int after) {
+    size_t low = 0;
+    size_t high = entryCount;
+
+    // Find the first entry past the time; the line is in the bucket before it
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (after ? entries[middle].time <= time : entries[middle].time < time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    size_t position = low > 0 ? entries[low - 1].offset : 0;
+    while (position < length) {
+        const char *newline = memchr(data + position, '\n', length - position);
+        size_t lineEnd = newline != NULL ? (size_t)(newline - data) : length;
+        int64_t lineTime;
+
+        if (lineTimestamp(data + position, data + lineEnd, &lineTime) &&
+            (after ? lineTime > time : lineTime >= time)) {
+            return position;
+        }
+        position = newline != NULL ? lineEnd + 1 : length;
+    }
+    return length;
+}
+
+/**
+ * @brief Memory-maps a text sensor file for indexing or a range query.
+ * 
+ * The program terminates if the file is empty, compressed, cannot be mapped, or is a column file.
+ * 
+ * @param inputFile The open sensor file.
+ * @param fileName The name of the sensor file, for messages.
+ * @param info Set to the status of the sensor file.
+ * @return char* The start of the mapping.
+ */
+char *mapTextSensorFile(FILE *inputFile, char *fileName, struct stat *info) {
+    if (fstat(fileno(inputFile), info) == 0 && S_ISFIFO(info->st_mode)) {
+        fprintf(stderr, "Warning: Terminating program (this needs an uncompressed sensor file).\n");
+        exit(1);
+    }
+    if (fstat(fileno(inputFile), info) != 0 || !S_ISREG(info->st_mode) || info->st_size == 0) {
+        fprintf(stderr, "Warning: Terminating program (no sensor data to process).\n");
+        exit(1);
+    }
+
+    char *data = mmap(NULL, info->st_size, PROT_READ, MAP_PRIVATE, fileno(inputFile), 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map file '%s'.\n", fileName);
+        exit(1);
+    }
+    if ((size_t)info->st_size >= sizeof(ColumnFileHeader) && memcmp(data, COLUMN_FILE_MAGIC, 8) == 0) {
+        fprintf(stderr, "Warning: Terminating program (time ranges need a text sensor file).\n");
+        exit(1);
+    }
+    return data;
+}
+
+/**
+ * @brief Returns the name of the time index file of a sensor file.
+ * 
+ * @param fileName The sensor file.
+ * @return char* The sensor file name followed by TIME_INDEX_SUFFIX, allocated with malloc.
+ */
+char *timeIndexName(char *fileName) {
+    char *indexName = malloc(strlen(fileName) + strlen(TIME_INDEX_SUFFIX) + 1);
+
+    if (indexName == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    sprintf(indexName, "%s%s", fileName, TIME_INDEX_SUFFIX);
+    return indexName;
+}
+
+/**
+ * @brief Builds the time index of a sensor file and saves it next to the file.
+ * 
+ * @param fileName The sensor file to index.
+ */
+void indexSensorFile(char *fileName) {
+    FILE *inputFile = openFile(fileName);
+    struct stat info;
+    size_t entryCount;
+    char *data = mapTextSensorFile(inputFile, fileName, &info);
+    char *indexName = timeIndexName(fileName);
+    TimeIndexEntry *entries = buildTimeIndex(data, info.st_size, options.indexBucket, &entryCount);
+
+    if (!saveTimeIndex(indexName, &info, entries, entryCount)) {
+        fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", indexName);
+        exit(1);
+    }
+    printf("Indexed '%s' into '%s' (%zu buckets of %ld seconds).\n",
+           fileName, indexName, entryCount, options.indexBucket);
+
+    free(entries);
+    free(indexName);
+    munmap(data, info.st_size);
+    fclose(inputFile);
+}
+
+/**
+ * @brief Analyzes only the lines of a sensor file whose timestamps fall in a range.
+ * 
+ * The time index finds where the range starts and ends, so only the lines in
+ * the range and the ones sharing the boundary buckets are read. The lines in
+ * the range are then parsed like a whole file. If there is no current index,
+ * one is built and saved for the next query. Lines must be in time order.
+ * 
+ * @param fileName The sensor file to query.
+ * @param startTime The first time in the range, in seconds since the epoch.
+ * @param endTime The last time in the range, in seconds since the epoch.
+ * @param outputFile The file where the results are written.
+ */
+void querySensorRange(char *fileName, int64_t startTime, int64_t endTime, FILE *outputFile) {
+    FILE *inputFile = openFile(fileName);
+    struct stat info;
+    size_t entryCount;
+    SensorAnalysis analysis;
+    char *data = mapTextSensorFile(inputFile, fileName, &info);
+    char *indexName = timeIndexName(fileName);
+    TimeIndexEntry *entries = loadTimeIndex(indexName, &info, &entryCount);
+
+    if (entries == NULL) {
+        entries = buildTimeIndex(data, info.st_size, options.indexBucket, &entryCount);
+        saveTimeIndex(indexName, &info, entries, entryCount);
+    }
+
+    size_t start = findTimeOffset(data, info.st_size, entries, entryCount, startTime, 0);
+    size_t end = findTimeOffset(data, info.st_size, entries, entryCount, endTime, 1);
+
+    initSensorAnalysis(&analysis);
+    if (end > start) {
+        scanSensorMapping(&analysis, data + start, end - start, options.threads);
+    }
+    checkSensorAnalysis(&analysis);
+    reportSensorAnalysis(&analysis, outputFile);
+
+    freeSensorAnalysis(&analysis);
+    free(entries);
+    free(indexName);
+    munmap(data, info.st_size);
+    fclose(inputFile);
+}
+
+/**
+ * @brief Follows a growing file or a pipe and reports statistics over a sliding window.
+ * 
+ * Lines are parsed as they arrive and added to the window, and the oldest rows
+ * are dropped once the window holds more than the requested number of rows or
+ * they arrived more than the requested number of seconds ago. The window is
+ * reported every options.interval seconds. At the end of a regular file the
+ * function waits for more data, like tail -f, and starts over if the file is
+ * truncated. At the end of a pipe the window is reported one last time.
+ * 
+ * @param fd The file descriptor to follow.
+ * @param outputFile The file where each report is written.
+ */
+void followSensorData(int fd, FILE *outputFile) {
+    size_t capacity = READ_BLOCK_SIZE;
+    size_t length = 0;
+    off_t offset = 0;               // Bytes read from a regular file so far
+    char *data = malloc(capacity);
+    RollingWindow window;
+    struct stat info;
+
+    if (data == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    int regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    initRollingWindow(&window);
+    double nextReport = currentSeconds() + options.interval;
+
+    while (1) {
+        double now = currentSeconds();
+        ssize_t count = 0;
+
+        // Report the window whenever the interval has passed
+        if (now >= nextReport) {
+            expireWindowRows(&window, now);
+            printWindow(&window, outputFile);
+            nextReport = nextReport + options.interval > now ? nextReport + options.interval
+                                                             : now + options.interval;
+        }
+        int timeout = (int)((nextReport - now) * 1000) + 1;
+
+        // Grow the buffer when a single line fills it
+        if (length == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            if (data == NULL) {
+                fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+                exit(1);
+            }
+        }
+
+        if (regular) {
+            count = read(fd, data + length, capacity - length);
+            if (count == 0) {
+                // Start over if the file was truncated, otherwise wait for it to grow
+                if (fstat(fd, &info) == 0 && info.st_size < offset) {
+                    lseek(fd, 0, SEEK_SET);
+                    offset = 0;
+                    length = 0;
+                    continue;
+                }
+                struct timespec pause = { 0, (timeout < FOLLOW_POLL_MS ? timeout : FOLLOW_POLL_MS) * 1000000L };
+                nanosleep(&pause, NULL);
+                continue;
+            }
+        } else {
+            struct pollfd ready = { fd, POLLIN, 0 };
+            if (poll(&ready, 1, timeout) <= 0) {
+                continue;
+            }
+            count = read(fd, data + length, capacity - length);
+            if (count == 0) {
+                break;
+            }
+        }
+        if (count < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            fprintf(stderr, "Warning: Terminating program (could not read sensor data).\n");
+            exit(1);
+        }
+        length += count;
+        offset += count;
+
+        // Add the complete lines and keep the partial one for the next read
+        size_t used = addWindowLines(&window, data, length, 0);
+        memmove(data, data + used, length - used);
+        length -= used;
+    }
+
+    addWindowLines(&window, data, length, 1);
+    expireWindowRows(&window, currentSeconds());
+    printWindow(&window, outputFile);
+    freeRollingWindow(&window);
+    free(data);
+}
+
+/**
+ * @brief Parses every complete line in a buffer and adds it to the window.
+ * 
+ * @param window The window that rows are added to.
+ * @param data The start of the buffer.
+ * @param length The number of bytes in the buffer.
+ * @param final Nonzero if no more data follows, so a last line without a newline is added too.
+ * @return size_t The number of bytes parsed, which always ends on a line boundary.
+ */
+size_t addWindowLines(RollingWindow *window, const char *data, size_t length, int final) {
+    const char *position = data;
+    const char *end = data + length;
+    float readings[MAX_SENSORS];
+    const char *timeStamp;
+    size_t timeStampLength;
+    char error[ERROR_BUFFER];
+
+    while (position < end) {
+        const char *newline = memchr(position, '\n', end - position);
+
+        if (newline == NULL) {
+            if (!final) {
+                break;
+            }
+            newline = end;
+        }
+
+        int numSensors = parseSensorRow(position, newline, readings, 1, &timeStamp, &timeStampLength,
+                                        error);
+        if (numSensors == -2) {
+            fprintf(stderr, "Warning: Terminating program (%s).\n", error);
+            exit(1);
+        }
+        if (numSensors >= 0) {
+            addWindowRow(window, readings, numSensors, currentSeconds());
+            copyTimestamp(window->lastTimestamp, timeStamp, timeStampLength);
+            expireWindowRows(window, currentSeconds());
+        }
+        position = newline < end ? newline + 1 : end;
+    }
+    return position - data;
+}
+
+/**
+ * @brief Sets up an empty sliding window.
+ * 
+ * @param window The window to set up.
+ */
+void initRollingWindow(RollingWindow *window) {
+    memset(window, 0, sizeof(*window));
+    window->sensors = -1;
+    strcpy(window->lastTimestamp, " ");
+}
+
+/**
+ * @brief Frees the memory held by a sliding window.
+ * 
+ * @param window The window to free.
+ */
+void freeRollingWindow(RollingWindow *window) {
+    free(window->values);
+    free(window->arrivals);
+    free(window->maxQueue);
+    free(window->minQueue);
+}
+
+/**
+ * @brief Doubles the number of rows a sliding window can hold.
+ * 
+ * Rows and queue entries are stored at their sequence number modulo the
+ * capacity, so each one is copied to its slot for the new capacity.
+ * 
+ * @param window The window to grow.
+ */
+void growRollingWindow(RollingWindow *window) {
+    long oldCapacity = window->capacity;
+    long capacity = oldCapacity ? oldCapacity * 2 : 1024;
+    int sensors = window->sensors;
+    float *values = malloc(capacity * sensors * sizeof(float) + 1);
+    double *arrivals = malloc(capacity * sizeof(double));
+    long *maxQueue = malloc(capacity * sensors * sizeof(long) + 1);
+    long *minQueue = malloc(capacity * sensors * sizeof(long) + 1);
+
+    if (values == NULL || arrivals == NULL || maxQueue == NULL || minQueue == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+
+    for (long row = window->head; row < window->tail; row++) {
+        memcpy(values + (row & (capacity - 1)) * sensors,
+               window->values + (row & (oldCapacity - 1)) * sensors, sensors * sizeof(float));
+        arrivals[row & (capacity - 1)] = window->arrivals[row & (oldCapacity - 1)];
+    }
+    for (int i = 0; i < sensors; i++) {
+        for (long position = window->maxFront[i]; position < window->maxBack[i]; position++) {
+            maxQueue[i * capacity + (position & (capacity - 1))] =
+                window->maxQueue[i * oldCapacity + (position & (oldCapacity - 1))];
+        }
+        for (long position = window->minFront[i]; position < window->minBack[i]; position++) {
+            minQueue[i * capacity + (position & (capacity - 1))] =
+                window->minQueue[i * oldCapacity + (position & (oldCapacity - 1))];
+        }
+    }
+
+    freeRollingWindow(window);
+    window->values = values;
+    window->arrivals = arrivals;
+    window->maxQueue = maxQueue;
+    window->minQueue = minQueue;
+    window->capacity = capacity;
+}
+
+/**
+ * @brief Adds a row of readings to the newest end of a sliding window.
+ * 
+ * The running mean and variance take the reading with Welford's update. Each
+ * sensor keeps a queue of the rows that could still become its maximum: rows
+ * with a smaller reading than the new one can never be the maximum again and
+ * are dropped from the back, so the front of the queue is always the maximum.
+ * The minimum works the same way. Each row enters and leaves each queue once,
+ * so the work per row is constant on average.
+ * 
+ * @param window The window to add the row to.
+ * @param readings The readings of the row.
+ * @param count The number of readings.
+ * @param arrival The time the row arrived, from currentSeconds.
+ */
+void addWindowRow(RollingWindow *window, const float *readings, int count, double arrival) {
+    if (window->sensors == -1) {
+        window->sensors = count;
+    } else if (count != window->sensors) {
+        fprintf(stderr, "Warning: Terminating program (inconsistent sensor readings).");
+        exit(1);
+    }
+    if (window->tail - window->head == window->capacity) {
+        growRollingWindow(window);
+    }
+
+    long mask = window->capacity - 1;
+    long row = window->tail++;
+    float *values = window->values + (row & mask) * count;
+
+    memcpy(values, readings, count * sizeof(float));
+    window->arrivals[row & mask] = arrival;
+
+    for (int i = 0; i < count; i++) {
+        long *maxQueue = window->maxQueue + i * window->capacity;
+        long *minQueue = window->minQueue + i * window->capacity;
+
+        updateSensorStats(&window->stats[i], readings[i]);
+
+        while (window->maxBack[i] > window->maxFront[i] &&
+               window->values[(maxQueue[(window->maxBack[i] - 1) & mask] & mask) * count + i] < readings[i]) {
+            window->maxBack[i]--;
+        }
+        maxQueue[window->maxBack[i]++ & mask] = row;
+
+        while (window->minBack[i] > window->minFront[i] &&
+               window->values[(minQueue[(window->minBack[i] - 1) & mask] & mask) * count + i] > readings[i]) {
+            window->minBack[i]--;
+        }
+        minQueue[window->minBack[i]++ & mask] = row;
+    }
+}
+
+/**
+ * @brief Drops the oldest row from a sliding window.
+ * 
+ * @param window The window to drop the row from.
+ */
+void removeWindowRow(RollingWindow *window) {
+    long mask = window->capacity - 1;
+    long row = window->head++;
+    const float *values = window->values + (row & mask) * window->sensors;
+
+    for (int i = 0; i < window->sensors; i++) {
+        removeFromSensorStats(&window->stats[i], values[i]);
+
+        if (window->maxQueue[i * window->capacity + (window->maxFront[i] & mask)] == row) {
+            window->maxFront[i]++;
+        }
+        if (window->minQueue[i * window->capacity + (window->minFront[i] & mask)] == row) {
+            window->minFront[i]++;
+        }
+    }
+
+    if (++window->removedRows >= window->tail - window->head) {
+        recomputeWindowStats(window);
+    }
+}
+
+/**
+ * @brief Recomputes the running statistics of a sliding window from its rows.
+ * 
+ * Each reading taken out with removeFromSensorStats leaves its rounding error
+ * in the mean and squared deviations, and the error of a large reading can
+ * swamp the spread of small ones that follow it. Starting again from the rows
+ * once the window has turned over bounds that error to one window's worth of
+ * removals, and costs one pass over rows that were already paid for by their
+ * removals.
+ * 
+ * @param window The window whose statistics are recomputed.
+ */
+void recomputeWindowStats(RollingWindow *window) {
+    long mask = window->capacity - 1;
+    long rows = window->tail - window->head;
+
+    for (int i = 0; i < window->sensors; i++) {
+        double sum = 0.0;
+        double m2 = 0.0;
+
+        for (long row = window->head; row < window->tail; row++) {
+            sum += window->values[(row & mask) * window->sensors + i];
+        }
+        double mean = rows > 0 ? sum / rows : 0.0;
+        for (long row = window->head; row < window->tail; row++) {
+            double delta = window->values[(row & mask) * window->sensors + i] - mean;
+            m2 += delta * delta;
+        }
+
+        window->stats[i].count = rows;
+        window->stats[i].mean = mean;
+        window->stats[i].m2 = m2;
+    }
+    window->removedRows = 0;
+}
+
+/**
+ * @brief Drops the rows that have fallen out of a sliding window.
+ * 
+ * @param window The window to trim.
+ * @param now The current time, from currentSeconds.
+ */
+void expireWindowRows(RollingWindow *window, double now) {
+    long mask = window->capacity - 1;
+
+    if (options.windowRows > 0) {
+        while (window->tail - window->head > options.windowRows) {
+            removeWindowRow(window);
+        }
+    }
+    if (options.windowSeconds > 0) {
+        while (window->tail > window->head &&
+               window->arrivals[window->head & mask] < now - options.windowSeconds) {
+            removeWindowRow(window);
+        }
+    }
+}
+
+/**
+ * @brief Takes a reading back out of a sensor's running statistics.
+ * 
+ * This reverses updateSensorStats, so that a sliding window can drop its oldest
+ * reading without going over the rest of the readings again.
+ * 
+ * @param stats The running statistics to update.
+ * @param reading The reading to take out, which must have been folded in before.
+ */
+void removeFromSensorStats(SensorStats *stats, double reading) {
+    if (stats->count <= 1) {
+        stats->count = 0;
+        stats->mean = 0.0;
+        stats->m2 = 0.0;
+        return;
+    }
+
+    double delta = reading - stats->mean;
+
+    stats->count--;
+    stats->mean -= delta / stats->count;
+    stats->m2 -= delta * (reading - stats->mean);
+    if (stats->m2 < 0) {
+        stats->m2 = 0; // Rounding can leave a negative sum until the window is recomputed
+    }
+}
+
+/**
+ * @brief Prints the statistics of every sensor over a sliding window.
+ * 
+ * @param window The window to print.
+ * @param outputFile The file where the statistics are printed.
+ */
+void printWindow(const RollingWindow *window, FILE *outputFile) {
+    long rows = window->tail - window->head;
+    long mask = window->capacity - 1;
+
+    if (rows == 0) {
+        fprintf(outputFile, "Window is empty.\n\n");
+        fflush(outputFile);
+        return;
+    }
+
+    fprintf(outputFile, "Window of %ld rows ending at %s:\n", rows, window->lastTimestamp);
+    for (int i = 0; i < window->sensors; i++) {
+        long maxRow = window->maxQueue[i * window->capacity + (window->maxFront[i] & mask)];
+        long minRow = window->minQueue[i * window->capacity + (window->minFront[i] & mask)];
+        float mean, std_dev;
+
+        finishSensorStats(&window->stats[i], &mean, &std_dev);
+        fprintf(outputFile, "Sensor %d:\n", i + 1);
+        fprintf(outputFile, "  - mean: %.2f\n", mean);
+        fprintf(outputFile, "  - deviation: %.2f\n", std_dev);
+        fprintf(outputFile, "  - min: %g\n", window->values[(minRow & mask) * window->sensors + i]);
+        fprintf(outputFile, "  - max: %g\n", window->values[(maxRow & mask) * window->sensors + i]);
+    }
+    fprintf(outputFile, "\n");
+    fflush(outputFile);
+}
+
+/**
+ * @brief Validates if a string represents a valid sensor reading.
+ * 
+ * This function checks if the input string is a valid sensor reading, defined as:
+ * (May contain one '.', one 'e' or one 'E', one '+' or one '-')
+ * 
+ * @param str The input string representing the sensor reading to be validated.
+ * @return int Returns 1 if the string is a valid sensor reading, otherwise returns 0.
+ */
+int isValidSensorReading(char *str) {
+    int hasDigit = 0;
+    int hasEe = 0;
+    int hasDot = 0;
+    int i = 0;
+
+    if (str[i] == '+' || str[i] == '-'){
+        i++;
+    }
+
+    while(str[i] != '\0' && str[i] != '\n') {
+        if(isdigit(str[i])) {
+            hasDigit = 1;
+        } 
+        
+        else if (str[i] == '.') {
+            if (hasDot || hasEe) {
+                return 0;
+            }
+            hasDot = 1;
+        }
+
+        else if (str[i] == 'e' || str[i] == 'E') {
+            if (hasEe || !hasDigit) {
+                return 0;
+            }
+            hasEe = 1;
+            i++;
+
+            if (str[i] == '+' || str[i] == '-'){
+                i++;
+            }
+        if(!isdigit(str[i])) {
+            return 0;
+        }
+        }
+        
+        else {
+            return 0;
+        }
+
+    i++;
+    }
+
+return hasDigit;
+}
+
+/**
+ * @brief Validates and converts a sensor reading in a single pass.
+ * 
+ * This function accepts exactly the readings that isValidSensorReading accepts, and
+ * gives the same value as atof, without needing a NUL-terminated copy of the token.
+ * Readings with up to 19 significant digits and a small exponent are converted
+ * exactly with one multiplication or division by a power of ten. Anything else is
+ * handed to strtod.
+ * 
+ * @param start The first character of the reading.
+ * @param end One past the last character of the reading.
+ * @param value A pointer to the variable where the converted reading will be stored.
+ * @return int Returns 1 if the token is a valid sensor reading, otherwise returns 0.
+ */
+int parseSensorReading(const char *start, const char *end, float *value) {
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *position = start;
+    uint64_t mantissa = 0;      // Significant digits of the reading
+    int digits = 0;             // Number of significant digits in mantissa
+    int exponent = 0;           // Power of ten that mantissa is scaled by
+    int hasDigit = 0;
+    int inexact = 0;            // Set when digits past the 19th were dropped
+    int negative = 0;
+
+    if (position < end && (*position == '+' || *position == '-')) {
+        negative = (*position == '-');
+        position++;
+    }
+
+    // Integer part
+    for (; position < end && isdigit((unsigned char)*position); position++) {
+        hasDigit = 1;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*position - '0');
+            digits += (mantissa != 0);
+        } else {
+            exponent++;
+            inexact |= (*position != '0');
+        }
+    }
+
+    // Fractional part
+    if (position < end && *position == '.') {
+        for (position++; position < end && isdigit((unsigned char)*position); position++) {
+            hasDigit = 1;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*position - '0');
+                digits += (mantissa != 0);
+                exponent--;
+            } else {
+                inexact |= (*position != '0');
+            }
+        }
+    }
+
+    if (!hasDigit) {
+        return 0;
+    }
+
+    // Exponent part, which must have at least one digit
+    if (position < end && (*position == 'e' || *position == 'E')) {
+        int negativeExponent = 0;
+        int exponentValue = 0;
+
+        position++;
+        if (position < end && (*position == '+' || *position == '-')) {
+            negativeExponent = (*position == '-');
+            position++;
+        }
+        if (position >= end || !isdigit((unsigned char)*position)) {
+            return 0;
+        }
+        for (; position < end && isdigit((unsigned char)*position); position++) {
+            if (exponentValue < 100000) {
+                exponentValue = exponentValue * 10 + (*position - '0');
+            }
+        }
+        exponent += negativeExponent ? -exponentValue : exponentValue;
+    }
+
+    if (position != end) {
+        return 0;
+    }
+
+    // Exact conversion when both the digits and the power of ten fit in a double
+    if (!inexact && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        double result = (double)mantissa;
+
+        result = exponent < 0 ? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+        *value = negative ? -result : result;
+        return 1;
+    }
+
+    // Otherwise let strtod round the reading
+    char copy[128];
+    size_t length = end - start;
+    char *text = length < sizeof(copy) ? copy : malloc(length + 1);
+
+    if (text == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    memcpy(text, start, length);
+    text[length] = '\0';
+    *value = strtod(text, NULL);
+    if (text != copy) {
+        free(text);
+    }
+    return 1;
+}
+
+/**
+ * @brief Calculates the mean and standard deviation for a set of sensor readings.
+ * 
+ * This function calculates the mean and standard deviation of the given sensor readings
+ * with the selected column kernels. 
+ * If the count is 0, both the mean and standard deviation are set to 0. 
+ * If there is only one reading, the standard deviation is also set to 0.
+ * 
+ * @param readings Array of sensor readings.
+ * @param count The number of sensor readings.
+ * @param mean A pointer to the variable where the mean will be stored
+ * @param std_dev A pointer to the variable where the standard deviation will be stored.
+ */
+void calcSensorStats(float readings[], int count, float *mean, float *std_dev) {
+    SensorStats stats = {0};
+
+    // Sum the readings, then the squared differences from their mean
+    if (count > 0) {
+        stats.count = count;
+        stats.mean = columnKernels->sum(readings, count) / count;
+        stats.m2 = columnKernels->squaredDeviations(readings, count, stats.mean);
+    }
+
+    finishSensorStats(&stats, mean, std_dev);
+}
+
+/**
+ * @brief Folds a single reading into a sensor's running statistics.
+ * 
+ * This function uses Welford's method, which updates the mean and the sum of
+ * squared differences from the mean without subtracting two large sums, so the
+ * result stays accurate for long runs of readings with a large offset.
+ * 
+ * @param stats The running statistics to update.
+ * @param reading The new sensor reading.
+ */
+void updateSensorStats(SensorStats *stats, double reading) {
+    double delta = reading - stats->mean;
+
+    stats->count++;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (reading - stats->mean);
+}
+
+/**
+ * @brief Calculates the mean and standard deviation from running statistics.
+ * 
+ * If there are no readings, both the mean and standard deviation are set to 0.
+ * If there is only one reading, the standard deviation is also set to 0.
+ * 
+ * @param stats The running statistics of a sensor.
+ * @param mean A pointer to the variable where the mean will be stored
+ * @param std_dev A pointer to the variable where the standard deviation will be stored.
+ */
+void finishSensorStats(const SensorStats *stats, float *mean, float *std_dev) {
+    // If there are no readings, mean and std dev are 0
+    if (stats->count == 0) {
+        *mean = 0.0;
+        *std_dev = 0.0;
+        return;
+    }
+
+    *mean = stats->mean;
+
+    // For more than one reading, calculate the sample standard deviaton
+    if (stats->count > 1) {
+        *std_dev = sqrt(stats->m2 / (stats->count - 1));
+    } else {
+        *std_dev = 0.0; // std dev is 0 for one reading
+    }
+}
+
+/**
+ * @brief Chooses the fastest column kernels that this CPU supports.
+ * 
+ * @return const ColumnKernels* The AVX2 kernels, the SSE2 kernels, or the scalar fallback.
+ */
+const ColumnKernels *selectColumnKernels(void) {
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &avx2Kernels;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return &sseKernels;
+    }
+#endif
+    return &scalarKernels;
+}
+
+/**
+ * @brief Sums a column of readings in double precision.
+ * 
+ * @param column The readings of one sensor.
+ * @param count The number of readings.
+ * @return double The sum of the readings.
+ */
+double sumColumnScalar(const float *column, int count) {
+    double sum = 0.0;
+
+    for (int i = 0; i < count; i++) {
+        sum += column[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Sums the squared differences between a column of readings and their mean.
+ * 
+ * Squaring the differences from the mean, rather than the readings themselves,
+ * avoids the cancellation of the sum/sum-of-squares formula.
+ * 
+ * @param column The readings of one sensor.
+ * @param count The number of readings.
+ * @param mean The mean of the readings.
+ * @return double The sum of squared differences from the mean.
+ */
+double squaredDeviationsScalar(const float *column, int count, double mean) {
+    double sum = 0.0;
+
+    for (int i = 0; i < count; i++) {
+        double delta = column[i] - mean;
+        sum += delta * delta;
+    }
+    return sum;
+}
+
+/**
+ * @brief Multiplies four centered sensors with eight others over a tile of rows.
+ * 
+ * The centered readings are stored row by row, stride values apart, so the
+ * readings of the four sensors and of the eight sensors in a row are next to
+ * each other.
+ * 
+ * @param rows The first of the four sensors in the first row.
+ * @param columns The first of the eight sensors in the first row.
+ * @param stride The number of values from one row to the next.
+ * @param count The number of rows.
+ * @param result Set to the sum over the rows of each of the four times each of the eight.
+ */
+void crossProductsScalar(const double *rows, const double *columns, int stride, int count, double result[4][8]) {
+    double sums[4][8] = {{ 0.0 }};
+
+    for (int k = 0; k < count; k++) {
+        for (int a = 0; a < 4; a++) {
+            for (int b = 0; b < 8; b++) {
+                sums[a][b] += rows[k * stride + a] * columns[k * stride + b];
+            }
+        }
+    }
+    memcpy(result, sums, sizeof(sums));
+}
+
+/**
+ * @brief Finds the smallest and largest reading in a column and the first row of each.
+ * 
+ * @param column The readings of one sensor.
+ * @param count The number of readings, at least one.
+ * @param result Where the extremes are stored.
+ */
+void columnExtremesScalar(const float *column, int count, ColumnExtremes *result) {
+    result->min = result->max = column[0];
+    result->minRow = result->maxRow = 0;
+
+    for (int i = 1; i < count; i++) {
+        if (column[i] < result->min) {
+            result->min = column[i];
+            result->minRow = i;
+        }
+        if (column[i] > result->max) {
+            result->max = column[i];
+            result->maxRow = i;
+        }
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+/**
+ * @brief Picks the extremes of several lanes, keeping the lowest row on ties.
+ * 
+ * Each lane holds the first row its own extreme occurs at, so the lowest row
+ * among the lanes that hold the overall extreme is the first row overall.
+ * 
+ * @param mins Smallest reading of each lane.
+ * @param minRows Row of the smallest reading of each lane.
+ * @param maxs Largest reading of each lane.
+ * @param maxRows Row of the largest reading of each lane.
+ * @param lanes The number of lanes.
+ * @param result Where the extremes are stored.
+ */
+static void reduceExtremeLanes(const float *mins, const int *minRows, const float *maxs,
+                               const int *maxRows, int lanes, ColumnExtremes *result) {
+    *result = (ColumnExtremes){ mins[0], minRows[0], maxs[0], maxRows[0] };
+
+    for (int i = 1; i < lanes; i++) {
+        if (mins[i] < result->min || (mins[i] == result->min && minRows[i] < result->minRow)) {
+            result->min = mins[i];
+            result->minRow = minRows[i];
+        }
+        if (maxs[i] > result->max || (maxs[i] == result->max && maxRows[i] < result->maxRow)) {
+            result->max = maxs[i];
+            result->maxRow = maxRows[i];
+        }
+    }
+}
+
+/**
+ * @brief Finishes the extremes of a column with the rows left over after the vector loop.
+ * 
+ * @param column The readings of one sensor.
+ * @param start The first row not covered by the vector loop.
+ * @param count The number of readings.
+ * @param result The extremes so far, updated in place.
+ */
+static void finishColumnExtremes(const float *column, int start, int count, ColumnExtremes *result) {
+    for (int i = start; i < count; i++) {
+        if (column[i] < result->min) {
+            result->min = column[i];
+            result->minRow = i;
+        }
+        if (column[i] > result->max) {
+            result->max = column[i];
+            result->maxRow = i;
+        }
+    }
+}
+
+/**
+ * @brief SSE2 version of sumColumnScalar, four readings at a time.
+ */
+double sumColumnSse(const float *column, int count) {
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 readings = _mm_loadu_ps(column + i);
+        low = _mm_add_pd(low, _mm_cvtps_pd(readings));
+        high = _mm_add_pd(high, _mm_cvtps_pd(_mm_movehl_ps(readings, readings)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(low, high));
+    double sum = lanes[0] + lanes[1];
+    for (; i < count; i++) {
+        sum += column[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief SSE2 version of squaredDeviationsScalar, four readings at a time.
+ */
+double squaredDeviationsSse(const float *column, int count, double mean) {
+    __m128d center = _mm_set1_pd(mean);
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 readings = _mm_loadu_ps(column + i);
+        __m128d lowDelta = _mm_sub_pd(_mm_cvtps_pd(readings), center);
+        __m128d highDelta = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(readings, readings)), center);
+        low = _mm_add_pd(low, _mm_mul_pd(lowDelta, lowDelta));
+        high = _mm_add_pd(high, _mm_mul_pd(highDelta, highDelta));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(low, high));
+    double sum = lanes[0] + lanes[1];
+    for (; i < count; i++) {
+        double delta = column[i] - mean;
+        sum += delta * delta;
+    }
+    return sum;
+}
+
+/**
+ * @brief SSE2 version of crossProductsScalar, for four of the eight sensors at a time.
+ */
+void crossProductsSse(const double *rows, const double *columns, int stride, int count, double result[4][8]) {
+    for (int half = 0; half < 8; half += 4) {
+        __m128d sums[4][2];
+
+        for (int a = 0; a < 4; a++) {
+            sums[a][0] = sums[a][1] = _mm_setzero_pd();
+        }
+        for (int k = 0; k < count; k++) {
+            __m128d low = _mm_loadu_pd(columns + k * stride + half);
+            __m128d high = _mm_loadu_pd(columns + k * stride + half + 2);
+
+            for (int a = 0; a < 4; a++) {
+                __m128d reading = _mm_set1_pd(rows[k * stride + a]);
+                sums[a][0] = _mm_add_pd(sums[a][0], _mm_mul_pd(reading, low));
+                sums[a][1] = _mm_add_pd(sums[a][1], _mm_mul_pd(reading, high));
+            }
+        }
+        for (int a = 0; a < 4; a++) {
+            _mm_storeu_pd(result[a] + half, sums[a][0]);
+            _mm_storeu_pd(result[a] + half + 2, sums[a][1]);
+        }
+    }
+}
+
+/**
+ * @brief SSE2 version of columnExtremesScalar, four readings at a time.
+ * 
+ * Each lane tracks its own extremes and their rows, taking a new reading only
+ * when it is strictly smaller or larger, so every lane keeps its first occurrence.
+ */
+void columnExtremesSse(const float *column, int count, ColumnExtremes *result) {
+    if (count < 4) {
+        columnExtremesScalar(column, count, result);
+        return;
+    }
+
+    __m128i rows = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i step = _mm_set1_epi32(4);
+    __m128 mins = _mm_loadu_ps(column);
+    __m128 maxs = mins;
+    __m128i minRows = rows;
+    __m128i maxRows = rows;
+    int i = 4;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 readings = _mm_loadu_ps(column + i);
+        rows = _mm_add_epi32(rows, step);
+
+        __m128i less = _mm_castps_si128(_mm_cmplt_ps(readings, mins));
+        __m128i greater = _mm_castps_si128(_mm_cmpgt_ps(readings, maxs));
+        mins = _mm_min_ps(readings, mins);
+        maxs = _mm_max_ps(readings, maxs);
+        minRows = _mm_or_si128(_mm_and_si128(less, rows), _mm_andnot_si128(less, minRows));
+        maxRows = _mm_or_si128(_mm_and_si128(greater, rows), _mm_andnot_si128(greater, maxRows));
+    }
+
+    float laneMins[4], laneMaxs[4];
+    int laneMinRows[4], laneMaxRows[4];
+    _mm_storeu_ps(laneMins, mins);
+    _mm_storeu_ps(laneMaxs, maxs);
+    _mm_storeu_si128((__m128i *)laneMinRows, minRows);
+    _mm_storeu_si128((__m128i *)laneMaxRows, maxRows);
+    reduceExtremeLanes(laneMins, laneMinRows, laneMaxs, laneMaxRows, 4, result);
+    finishColumnExtremes(column, i, count, result);
+}
+
+/**
+ * @brief AVX2 version of sumColumnScalar, eight readings at a time.
+ */
+__attribute__((target("avx2")))
+double sumColumnAvx2(const float *column, int count) {
+    __m256d low = _mm256_setzero_pd();
+    __m256d high = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 readings = _mm256_loadu_ps(column + i);
+        low = _mm256_add_pd(low, _mm256_cvtps_pd(_mm256_castps256_ps128(readings)));
+        high = _mm256_add_pd(high, _mm256_cvtps_pd(_mm256_extractf128_ps(readings, 1)));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(low, high));
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < count; i++) {
+        sum += column[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief AVX2 version of squaredDeviationsScalar, eight readings at a time.
+ */
+__attribute__((target("avx2")))
+double squaredDeviationsAvx2(const float *column, int count, double mean) {
+    __m256d center = _mm256_set1_pd(mean);
+    __m256d low = _mm256_setzero_pd();
+    __m256d high = _mm256_setzero_pd();
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 readings = _mm256_loadu_ps(column + i);
+        __m256d lowDelta = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(readings)), center);
+        __m256d highDelta = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(readings, 1)), center);
+        low = _mm256_add_pd(low, _mm256_mul_pd(lowDelta, lowDelta));
+        high = _mm256_add_pd(high, _mm256_mul_pd(highDelta, highDelta));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(low, high));
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < count; i++) {
+        double delta = column[i] - mean;
+        sum += delta * delta;
+    }
+    return sum;
+}
+
+/**
+ * @brief AVX2 version of crossProductsScalar, all eight sensors at a time.
+ */
+__attribute__((target("avx2")))
+void crossProductsAvx2(const double *rows, const double *columns, int stride, int count, double result[4][8]) {
+    __m256d sums[4][2];
 
-    *mean = sum_x / count;
+    for (int a = 0; a < 4; a++) {
+        sums[a][0] = sums[a][1] = _mm256_setzero_pd();
+    }
+    for (int k = 0; k < count; k++) {
+        __m256d low = _mm256_loadu_pd(columns + k * stride);
+        __m256d high = _mm256_loadu_pd(columns + k * stride + 4);
 
-    // For more than one reading, calculate the standard deviaton
-    if (count > 1) {
-        float variance = (count * sum_x2 - sum_x * sum_x) / (count * (count - 1));
-        *std_dev = sqrt(variance);
-    } else {
-        *std_dev = 0.0; // std dev is 0 for one reading
+        for (int a = 0; a < 4; a++) {
+            __m256d reading = _mm256_broadcast_sd(rows + k * stride + a);
+            sums[a][0] = _mm256_add_pd(sums[a][0], _mm256_mul_pd(reading, low));
+            sums[a][1] = _mm256_add_pd(sums[a][1], _mm256_mul_pd(reading, high));
+        }
+    }
+    for (int a = 0; a < 4; a++) {
+        _mm256_storeu_pd(result[a], sums[a][0]);
+        _mm256_storeu_pd(result[a] + 4, sums[a][1]);
+    }
+}
+
+/**
+ * @brief AVX2 version of columnExtremesScalar, eight readings at a time.
+ */
+__attribute__((target("avx2")))
+void columnExtremesAvx2(const float *column, int count, ColumnExtremes *result) {
+    if (count < 8) {
+        columnExtremesScalar(column, count, result);
+        return;
+    }
+
+    __m256i rows = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i step = _mm256_set1_epi32(8);
+    __m256 mins = _mm256_loadu_ps(column);
+    __m256 maxs = mins;
+    __m256 minRows = _mm256_castsi256_ps(rows);
+    __m256 maxRows = minRows;
+    int i = 8;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 readings = _mm256_loadu_ps(column + i);
+        rows = _mm256_add_epi32(rows, step);
+
+        __m256 less = _mm256_cmp_ps(readings, mins, _CMP_LT_OQ);
+        __m256 greater = _mm256_cmp_ps(readings, maxs, _CMP_GT_OQ);
+        mins = _mm256_blendv_ps(mins, readings, less);
+        maxs = _mm256_blendv_ps(maxs, readings, greater);
+        minRows = _mm256_blendv_ps(minRows, _mm256_castsi256_ps(rows), less);
+        maxRows = _mm256_blendv_ps(maxRows, _mm256_castsi256_ps(rows), greater);
+    }
+
+    float laneMins[8], laneMaxs[8];
+    int laneMinRows[8], laneMaxRows[8];
+    _mm256_storeu_ps(laneMins, mins);
+    _mm256_storeu_ps(laneMaxs, maxs);
+    _mm256_storeu_si256((__m256i *)laneMinRows, _mm256_castps_si256(minRows));
+    _mm256_storeu_si256((__m256i *)laneMaxRows, _mm256_castps_si256(maxRows));
+    reduceExtremeLanes(laneMins, laneMinRows, laneMaxs, laneMaxRows, 8, result);
+    finishColumnExtremes(column, i, count, result);
+}
+#endif
+
+/**
+ * @brief Merges the partial result of a later part of the input into an analysis.
+ * 
+ * The part must come after everything already in the analysis, so that the
+ * earlier timestamp is kept when the part ties the maximum or minimum. An error
+ * in the part, or a part with a different number of sensors, is recorded as
+ * the analysis's error, and nothing more is merged once it has one.
+ * 
+ * @param analysis The analysis to merge into.
+ * @param part The partial result to merge.
+ */
+void mergeSensorAnalysis(SensorAnalysis *analysis, const SensorAnalysis *part) {
+    if (analysis->error[0] == '\0' && part->error[0] != '\0') {
+        strcpy(analysis->error, part->error);
+    }
+    if (analysis->error[0] != '\0' || part->totalReadings == 0) {
+        return;
+    }
+
+    // Check for consistent sensor readings across parts
+    if (analysis->expectedSensorCount == -1) {
+        analysis->expectedSensorCount = part->expectedSensorCount;
+    } else if (part->expectedSensorCount != analysis->expectedSensorCount) {
+        snprintf(analysis->error, ERROR_BUFFER, "inconsistent sensor readings");
+        return;
+    }
+
+    if (analysis->comoments != NULL && part->comoments != NULL) {
+        mergeComoments(analysis->comoments, analysis->stats, part->comoments, part->stats,
+                       part->expectedSensorCount);
+    }
+    for (int i = 0; i < part->expectedSensorCount; i++) {
+        mergeSensorStats(&analysis->stats[i], &part->stats[i]);
+        if (analysis->sketches != NULL && part->sketches != NULL) {
+            mergeSketch(&analysis->sketches[i], &part->sketches[i]);
+        }
+    }
+
+    if (part->maxReading > analysis->maxReading) {
+        analysis->maxReading = part->maxReading;
+        strcpy(analysis->maxTimestamp, part->maxTimestamp);
+    }
+    if (part->minReading < analysis->minReading) {
+        analysis->minReading = part->minReading;
+        strcpy(analysis->minTimestamp, part->minTimestamp);
+    }
+    analysis->totalReadings += part->totalReadings;
+}
+
+/**
+ * @brief Adds the cross products of a column block to the comoment matrix.
+ * 
+ * The comoment of sensors i and j is the sum over all rows of
+ * (reading i - mean i) * (reading j - mean j), from which the covariance and
+ * correlation follow. The block's own comoments are taken about the block
+ * means and merged in with the pairwise update of Chan et al., the same way
+ * mergeSensorStats merges the variance. Only the upper triangle is kept.
+ * 
+ * The block is centered CROSS_ROWS rows at a time into a row-major tile that
+ * stays in L1 cache (26 KB at 100 sensors), padded to a multiple of eight
+ * sensors with zeros. The crossProducts kernel then sweeps the tile for four
+ * by eight sensor pairs at a time, keeping all 32 sums in registers.
+ * 
+ * @param analysis The analysis to update, before the block's stats are merged into it.
+ * @param columns The readings of each sensor in the block.
+ * @param rows The number of rows in the block.
+ * @param parts The count and mean of each column of the block.
+ */
+void addColumnComoments(SensorAnalysis *analysis, const float *const columns[], int rows,
+                        const SensorStats *parts) {
+    int sensors = analysis->expectedSensorCount;
+    int stride = (sensors + 7) & ~7;
+    double centered[CROSS_ROWS * ((MAX_SENSORS + 7) & ~7)];
+    double products[4][8];
+
+    mergeComoments(analysis->comoments, analysis->stats, NULL, parts, sensors);
+
+    for (int first = 0; first < rows; first += CROSS_ROWS) {
+        int count = rows - first < CROSS_ROWS ? rows - first : CROSS_ROWS;
+
+        for (int i = 0; i < stride; i++) {
+            for (int k = 0; k < count; k++) {
+                centered[k * stride + i] = i < sensors ? columns[i][first + k] - parts[i].mean : 0.0;
+            }
+        }
+
+        for (int i = 0; i < sensors; i += 4) {
+            for (int j = i & ~7; j < sensors; j += 8) {
+                columnKernels->crossProducts(centered + i, centered + j, stride, count, products);
+
+                // Keep the pairs in the upper triangle that are real sensors
+                for (int a = 0; a < 4 && i + a < sensors; a++) {
+                    double *row = analysis->comoments + (i + a) * MAX_SENSORS;
+
+                    for (int b = i + a > j ? i + a - j : 0; b < 8 && j + b < sensors; b++) {
+                        row[j + b] += products[a][b];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Merges the comoments of two sets of rows.
+ * 
+ * Both comoment matrices are taken about their own means, so the merged matrix
+ * gains a correction for the difference between the means, which is the
+ * cross-sensor form of the update in mergeSensorStats. It must be called before
+ * the stats themselves are merged.
+ * 
+ * @param comoments The comoment matrix to merge into.
+ * @param stats The count and mean of each sensor of the rows already in comoments.
+ * @param partComoments The comoment matrix to merge, or NULL to only apply the correction.
+ * @param partStats The count and mean of each sensor of the rows being merged.
+ * @param sensors The number of sensors.
+ */
+void mergeComoments(double *comoments, const SensorStats *stats, const double *partComoments,
+                    const SensorStats *partStats, int sensors) {
+    double count = stats[0].count;
+    double partCount = partStats[0].count;
+    double weight = count * partCount / (count + partCount);
+    double delta[MAX_SENSORS];
+
+    if (partCount == 0) {
+        return;
+    }
+    for (int i = 0; i < sensors; i++) {
+        delta[i] = partStats[i].mean - stats[i].mean;
+    }
+
+    for (int i = 0; i < sensors; i++) {
+        for (int j = i; j < sensors; j++) {
+            double product = partComoments != NULL ? partComoments[i * MAX_SENSORS + j] : 0.0;
+
+            comoments[i * MAX_SENSORS + j] += product + delta[i] * delta[j] * weight;
+        }
+    }
+}
+
+/**
+ * @brief Prints the covariance and Pearson correlation matrices of the sensors.
+ * 
+ * A correlation with a sensor whose readings never change is printed as a dash.
+ * 
+ * @param outputFile The file where the matrices are printed.
+ * @param analysis The analysis holding the comoments.
+ */
+void printCorrelation(FILE *outputFile, const SensorAnalysis *analysis) {
+    int sensors = analysis->expectedSensorCount;
+    long count = analysis->stats[0].count;
+    const double *comoments = analysis->comoments;
+
+    fprintf(outputFile, "\nCovariance matrix:\n");
+    for (int i = 0; i < sensors; i++) {
+        fprintf(outputFile, "Sensor %d:", i + 1);
+        for (int j = 0; j < sensors; j++) {
+            double comoment = i <= j ? comoments[i * MAX_SENSORS + j] : comoments[j * MAX_SENSORS + i];
+
+            fprintf(outputFile, " %10.2f", count > 1 ? comoment / (count - 1) : 0.0);
+        }
+        fprintf(outputFile, "\n");
+    }
+
+    fprintf(outputFile, "\nCorrelation matrix:\n");
+    for (int i = 0; i < sensors; i++) {
+        fprintf(outputFile, "Sensor %d:", i + 1);
+        for (int j = 0; j < sensors; j++) {
+            double comoment = i <= j ? comoments[i * MAX_SENSORS + j] : comoments[j * MAX_SENSORS + i];
+            double scale = sqrt(comoments[i * MAX_SENSORS + i] * comoments[j * MAX_SENSORS + j]);
+
+            if (scale > 0) {
+                fprintf(outputFile, " %6.3f", comoment / scale);
+            } else {
+                fprintf(outputFile, " %6s", "-");
+            }
+        }
+        fprintf(outputFile, "\n");
+    }
+}
+
+/**
+ * @brief Merges the running statistics of two sets of readings.
+ * 
+ * This uses the pairwise form of Welford's method (Chan et al.), so the merged
+ * mean and variance are as accurate as if the readings had been folded in one at a time.
+ * 
+ * @param stats The running statistics to merge into.
+ * @param part The running statistics to merge.
+ */
+void mergeSensorStats(SensorStats *stats, const SensorStats *part) {
+    if (part->count == 0) {
+        return;
+    }
+    if (stats->count == 0) {
+        *stats = *part;
+        return;
+    }
+
+    long count = stats->count + part->count;
+    double delta = part->mean - stats->mean;
+
+    stats->mean += delta * part->count / count;
+    stats->m2 += part->m2 + delta * delta * ((double)stats->count * part->count / count);
+    stats->count = count;
+}
+
+/**
+ * @brief Adds a column of readings to a quantile sketch.
+ * 
+ * @param sketch The sketch to update.
+ * @param column The readings of one sensor.
+ * @param count The number of readings.
+ */
+void addToSketch(QuantileSketch *sketch, const float *column, int count) {
+    const double gamma = (1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY);
+    const double inverseLogGamma = 1.0 / log(gamma);
+
+    for (int i = 0; i < count; i++) {
+        double size = fabs(column[i]);
+
+        if (size < SKETCH_MIN_VALUE) {
+            sketch->zeroCount++;
+            continue;
+        }
+
+        // Bucket k holds sizes in (MIN * gamma^(k-1), MIN * gamma^k]
+        double bucket = ceil(log(size / SKETCH_MIN_VALUE) * inverseLogGamma);
+        int k = bucket < SKETCH_BUCKETS - 1 ? (int)bucket : SKETCH_BUCKETS - 1;
+        if (column[i] > 0) {
+            sketch->positive[k]++;
+        } else {
+            sketch->negative[k]++;
+        }
+    }
+}
+
+/**
+ * @brief Adds the counts of one quantile sketch to another.
+ * 
+ * @param sketch The sketch to merge into.
+ * @param part The sketch to merge.
+ */
+void mergeSketch(QuantileSketch *sketch, const QuantileSketch *part) {
+    sketch->zeroCount += part->zeroCount;
+    for (int k = 0; k < SKETCH_BUCKETS; k++) {
+        sketch->positive[k] += part->positive[k];
+        sketch->negative[k] += part->negative[k];
+    }
+}
+
+/**
+ * @brief Estimates a quantile of the readings in a sketch.
+ * 
+ * The buckets are walked from the most negative readings to the most positive
+ * until the rank of the quantile is passed. The middle of that bucket, in the
+ * relative sense, is reported.
+ * 
+ * @param sketch The sketch to query.
+ * @param quantile The quantile to estimate, from 0 to 1.
+ * @return double The estimated reading at that quantile, or 0 if the sketch is empty.
+ */
+double sketchQuantile(const QuantileSketch *sketch, double quantile) {
+    const double gamma = (1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY);
+    uint64_t total = sketch->zeroCount;
+
+    for (int k = 0; k < SKETCH_BUCKETS; k++) {
+        total += sketch->positive[k] + sketch->negative[k];
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+
+    uint64_t rank = (uint64_t)(quantile * (total - 1));
+    uint64_t seen = 0;
+
+    for (int k = SKETCH_BUCKETS - 1; k >= 0; k--) {
+        seen += sketch->negative[k];
+        if (seen > rank) {
+            return -SKETCH_MIN_VALUE * 2 * pow(gamma, k) / (gamma + 1);
+        }
+    }
+    seen += sketch->zeroCount;
+    if (seen > rank) {
+        return 0.0;
+    }
+    for (int k = 0; k < SKETCH_BUCKETS; k++) {
+        seen += sketch->positive[k];
+        if (seen > rank) {
+            return SKETCH_MIN_VALUE * 2 * pow(gamma, k) / (gamma + 1);
+        }
+    }
+    return SKETCH_MIN_VALUE * 2 * pow(gamma, SKETCH_BUCKETS - 1) / (gamma + 1);
+}
+
+/**
+ * @brief Reads the p50, p95 and p99 of each sensor from its sketch.
+ * 
+ * @param sketches The quantile sketch of each sensor.
+ * @param sensorCount The number of sensors.
+ * @param percentiles Receives the p50, p95 and p99 of each sensor.
+ */
+void findPercentiles(const QuantileSketch *sketches, int sensorCount, double (*percentiles)[3]) {
+    for (int i = 0; i < sensorCount; i++) {
+        percentiles[i][0] = sketchQuantile(&sketches[i], 0.50);
+        percentiles[i][1] = sketchQuantile(&sketches[i], 0.95);
+        percentiles[i][2] = sketchQuantile(&sketches[i], 0.99);
     }
 }
 
@@ -370,9 +3909,11 @@ void calcSensorStats(float readings[], int count, float *mean, float *std_dev) {
  * @param sensorCount The total number of sensors.
  * @param means Array containing the mean value for each sensor.
  * @param std_devs Array containing the standard deviation for each sensor.
+ * @param percentiles The p50, p95 and p99 of each sensor, or NULL to skip percentiles.
  */
 void printData(FILE *outputFile, float maxReading, char *maxTimestamp, float minReading, 
-               char *minTimestamp, int sensorCount, float *means, float *std_devs) {
+               char *minTimestamp, int sensorCount, float *means, float *std_devs,
+               double (*percentiles)[3]) {
 
     // Print the max and min readings with respective timestamps to output file            
     fprintf(outputFile, "Maximum recorded at %s (%g)\n", maxTimestamp, maxReading);
@@ -383,5 +3924,392 @@ void printData(FILE *outputFile, float maxReading, char *maxTimestamp, float min
         fprintf(outputFile, "Sensor %d:\n", i + 1);
         fprintf(outputFile, "  - mean: %.2f\n", means[i]);
         fprintf(outputFile, "  - deviation: %.2f\n", std_devs[i]);
+        if (percentiles != NULL) {
+            fprintf(outputFile, "  - p50: %.2f\n", percentiles[i][0]);
+            fprintf(outputFile, "  - p95: %.2f\n", percentiles[i][1]);
+            fprintf(outputFile, "  - p99: %.2f\n", percentiles[i][2]);
+        }
+    }
+}
+
+/**
+ * @brief Returns a monotonic clock reading in seconds, for timing.
+ * 
+ * @return double The current time in seconds.
+ */
+double currentSeconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Parses a sensor file the way readSensorData did before the in-place parser.
+ * 
+ * Each line is read with fgets, split with strtok, validated with
+ * isValidSensorReading and converted again with atof. Only used by the benchmark
+ * as a baseline for the in-place parser.
+ * 
+ * @param inputFile The file from which sensor data is read.
+ * @param analysis The analysis that the readings are added to.
+ */
+void parseSensorDataWithStdio(FILE *inputFile, SensorAnalysis *analysis) {
+    char timeStamp[BUFFER];
+    char line[MAX_LINE_LENGTH];
+
+    while (fgets(line, MAX_LINE_LENGTH, inputFile)) {
+        if (line[0] == '\0' || strspn(line, " \t\n\r") == strlen(line)) {
+            continue;
+        }
+
+        int numSensors = 0;
+        char *token = strtok(line, " \t");
+        strcpy(timeStamp, token);
+
+        for (token = strtok(NULL, " \t"); token != NULL && numSensors < MAX_SENSORS; token = strtok(NULL, " \t")) {
+            if (!isValidSensorReading(token)) {
+                continue;
+            }
+            float reading = atof(token);
+
+            updateSensorStats(&analysis->stats[numSensors], reading);
+            if (reading > analysis->maxReading) {
+                analysis->maxReading = reading;
+                strcpy(analysis->maxTimestamp, timeStamp);
+            }
+            if (reading < analysis->minReading) {
+                analysis->minReading = reading;
+                strcpy(analysis->minTimestamp, timeStamp);
+            }
+            numSensors++;
+        }
+        analysis->expectedSensorCount = numSensors;
+        analysis->totalReadings++;
+    }
+}
+
+/**
+ * @brief Compares the parse throughput of the stdio parser and the in-place parser.
+ * 
+ * The parsers run over the same file a few times and the best time of each is
+ * reported, so the page cache is warm for all of them. The in-place parser is
+ * timed on one thread and on the number of threads in the options, and
+ * readSensorData is timed from start to finish, report included. The stages of
+ * the stdio parser and the column kernels are then timed on their own.
+ * 
+ * @param fileName The sensor data file to parse.
+ */
+void benchmarkSensorParsers(char *fileName) {
+    const int runs = 3;
+    double stdioBest = INFINITY;
+    double mappedBest = INFINITY;
+    double parallelBest = INFINITY;
+    double readBest = INFINITY;
+    int threads = options.threads;
+    struct stat info;
+    SensorAnalysis analysis;
+
+    FILE *inputFile = openFile(fileName);
+    FILE *reportFile = writeFile("/dev/null");
+    if (fstat(fileno(inputFile), &info) != 0 || !S_ISREG(info.st_mode)) {
+        fprintf(stderr, "Warning: Terminating program (this needs an uncompressed sensor file).\n");
+        exit(1);
+    }
+
+    for (int run = 0; run < runs; run++) {
+        // Baseline: fgets, strtok, isValidSensorReading and atof
+        rewind(inputFile);
+        initSensorAnalysis(&analysis);
+        double start = currentSeconds();
+        parseSensorDataWithStdio(inputFile, &analysis);
+        double elapsed = currentSeconds() - start;
+        stdioBest = elapsed < stdioBest ? elapsed : stdioBest;
+        freeSensorAnalysis(&analysis);
+
+        // Memory-mapped in-place parser on one thread
+        initSensorAnalysis(&analysis);
+        start = currentSeconds();
+        scanSensorFile(&analysis, fileno(inputFile), 1);
+        checkSensorAnalysis(&analysis);
+        elapsed = currentSeconds() - start;
+        mappedBest = elapsed < mappedBest ? elapsed : mappedBest;
+        freeSensorAnalysis(&analysis);
+
+        // Memory-mapped in-place parser on all threads
+        initSensorAnalysis(&analysis);
+        start = currentSeconds();
+        scanSensorFile(&analysis, fileno(inputFile), threads);
+        checkSensorAnalysis(&analysis);
+        elapsed = currentSeconds() - start;
+        parallelBest = elapsed < parallelBest ? elapsed : parallelBest;
+        freeSensorAnalysis(&analysis);
+
+        // The whole of readSensorData, as main runs it
+        start = currentSeconds();
+        readSensorData(inputFile, reportFile);
+        elapsed = currentSeconds() - start;
+        readBest = elapsed < readBest ? elapsed : readBest;
+    }
+    fclose(reportFile);
+    fclose(inputFile);
+
+    char label[64];
+    size_t rows = analysis.totalReadings;
+    printf("File: %s (%lld bytes, %zu lines)\n", fileName, (long long)info.st_size, rows);
+    printBenchmarkLine("fgets/strtok/atof", stdioBest, rows, info.st_size);
+    printBenchmarkLine("mmap in place", mappedBest, rows, info.st_size);
+    snprintf(label, sizeof(label), "mmap, %d threads", threads);
+    printBenchmarkLine(label, parallelBest, rows, info.st_size);
+    printBenchmarkLine("readSensorData", readBest, rows, info.st_size);
+    printf("  - speedup: %.2fx (one thread), %.2fx (%d threads)\n",
+           stdioBest / mappedBest, stdioBest / parallelBest, threads);
+    printf("  - peak RSS: %.1f MB\n", peakMemory() / 1e6);
+
+    benchmarkSensorStages(fileName);
+    benchmarkColumnKernels(MAX_SENSORS, 4000000);
+}
+
+/**
+ * @brief Times each stage of the original stdio parser on its own.
+ * 
+ * The file is first split into lines and tokens, and the readings converted,
+ * outside of any timing, so that each stage can be run alone over the whole
+ * file: tokenizing lines with strtok, validating each reading with
+ * isValidSensorReading, converting each reading with atof (and with
+ * parseSensorReading for comparison), and calcSensorStats over each sensor's
+ * readings. Each stage runs a few times and its best time is reported.
+ * 
+ * @param fileName The sensor data file to parse.
+ */
+void benchmarkSensorStages(char *fileName) {
+    const int runs = 3;
+    FILE *inputFile = openFile(fileName);
+    struct stat info;
+    int sensorCount = 0;
+    char *data = mapTextSensorFile(inputFile, fileName, &info);
+    size_t length = info.st_size;
+    size_t rows = countSensorLines(data, length, &sensorCount);
+    char line[MAX_LINE_LENGTH];
+    double best[5] = { INFINITY, INFINITY, INFINITY, INFINITY, INFINITY };
+    volatile double sink = 0;
+
+    if (sensorCount == 0) {
+        printf("Stages of the stdio parser: no sensor readings in '%s'.\n", fileName);
+        munmap(data, length);
+        fclose(inputFile);
+        return;
+    }
+
+    // Copy every reading into a pool of NUL-terminated tokens
+    char *pool = malloc(length + 1);
+    size_t *tokens = malloc((rows * sensorCount + 1) * sizeof(*tokens));
+    float *readings = malloc((rows * sensorCount + 1) * sizeof(*readings));
+    if (pool == NULL || tokens == NULL || readings == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    size_t tokenCount = 0;
+    size_t poolLength = 0;
+    for (const char *position = data; position < data + length; ) {
+        const char *newline = memchr(position, '\n', data + length - position);
+        const char *end = newline != NULL ? newline : data + length;
+        const char *token = skipToken(skipBlanks(position, end), end);
+
+        for (token = skipBlanks(token, end); token < end; token = skipBlanks(token, end)) {
+            const char *tokenEnd = skipToken(token, end);
+
+            if (tokenEnd > token && tokenEnd[-1] == '\r') {
+                tokenEnd--;
+            }
+            if (tokenEnd > token && tokenCount < rows * sensorCount) {
+                tokens[tokenCount++] = poolLength;
+                memcpy(pool + poolLength, token, tokenEnd - token);
+                poolLength += tokenEnd - token;
+                pool[poolLength++] = '\0';
+            }
+            token = skipToken(token, end);
+        }
+        position = end + 1;
+    }
+    // Token i ends at the NUL just before the start of token i + 1
+    tokens[tokenCount] = poolLength;
+
+    for (int run = 0; run < runs; run++) {
+        // Tokenizing: copy each line out as fgets would and split it with strtok
+        double start = currentSeconds();
+        size_t counted = 0;
+        for (const char *position = data; position < data + length; ) {
+            const char *newline = memchr(position, '\n', data + length - position);
+            size_t lineLength = (newline != NULL ? newline : data + length) - position;
+
+            if (lineLength > MAX_LINE_LENGTH - 1) {
+                lineLength = MAX_LINE_LENGTH - 1;
+            }
+            memcpy(line, position, lineLength);
+            line[lineLength] = '\0';
+            for (char *token = strtok(line, " \t\r"); token != NULL; token = strtok(NULL, " \t\r")) {
+                counted++;
+            }
+            position = newline != NULL ? newline + 1 : data + length;
+        }
+        double elapsed = currentSeconds() - start;
+        best[0] = elapsed < best[0] ? elapsed : best[0];
+        sink += counted;
+
+        // Validating every reading
+        start = currentSeconds();
+        counted = 0;
+        for (size_t i = 0; i < tokenCount; i++) {
+            counted += isValidSensorReading(pool + tokens[i]);
+        }
+        elapsed = currentSeconds() - start;
+        best[1] = elapsed < best[1] ? elapsed : best[1];
+        sink += counted;
+
+        // Converting every reading with atof
+        start = currentSeconds();
+        for (size_t i = 0; i < tokenCount; i++) {
+            readings[i] = atof(pool + tokens[i]);
+        }
+        elapsed = currentSeconds() - start;
+        best[2] = elapsed < best[2] ? elapsed : best[2];
+
+        // Converting every reading with the in-place parser
+        start = currentSeconds();
+        for (size_t i = 0; i < tokenCount; i++) {
+            float value;
+            if (parseSensorReading(pool + tokens[i], pool + tokens[i + 1] - 1, &value)) {
+                counted++;
+                sink += value;
+            }
+        }
+        elapsed = currentSeconds() - start;
+        best[3] = elapsed < best[3] ? elapsed : best[3];
+    }
+
+    // Statistics over each sensor's readings, gathered into columns
+    float *columns = malloc((rows + 1) * sizeof(*columns) * sensorCount);
+    if (columns == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    size_t columnRows = tokenCount / sensorCount;
+    for (size_t row = 0; row < columnRows; row++) {
+        for (int i = 0; i < sensorCount; i++) {
+            columns[i * columnRows + row] = readings[row * sensorCount + i];
+        }
+    }
+    for (int run = 0; run < runs; run++) {
+        double start = currentSeconds();
+        for (int i = 0; i < sensorCount; i++) {
+            float mean, std_dev;
+
+            calcSensorStats(columns + i * columnRows, columnRows, &mean, &std_dev);
+            sink += mean + std_dev;
+        }
+        double elapsed = currentSeconds() - start;
+        best[4] = elapsed < best[4] ? elapsed : best[4];
+    }
+
+    printf("Stages of the stdio parser (%zu rows, %zu readings):\n", rows, tokenCount);
+    printBenchmarkLine("strtok tokenizing", best[0], rows, length);
+    printBenchmarkLine("isValidSensorReading", best[1], rows, length);
+    printBenchmarkLine("atof", best[2], rows, length);
+    printBenchmarkLine("parseSensorReading", best[3], rows, length);
+    printBenchmarkLine("calcSensorStats", best[4], rows, length);
+    printf("  - peak RSS: %.1f MB\n", peakMemory() / 1e6);
+
+    free(columns);
+    free(readings);
+    free(tokens);
+    free(pool);
+    munmap(data, length);
+    fclose(inputFile);
+}
+
+/**
+ * @brief Prints the time and throughput of one benchmark.
+ * 
+ * @param label What was timed.
+ * @param seconds The best time.
+ * @param rows The number of rows processed.
+ * @param bytes The number of bytes processed.
+ */
+void printBenchmarkLine(const char *label, double seconds, size_t rows, size_t bytes) {
+    printf("  - %-24s %8.3f s  %8.2f M rows/s  %8.1f MB/s\n",
+           label, seconds, rows / seconds / 1e6, bytes / seconds / 1e6);
+}
+
+/**
+ * @brief Returns the most memory the program has had resident at once.
+ * 
+ * @return double The peak resident set size in bytes.
+ */
+double peakMemory(void) {
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss * 1024.0;
+}
+
+/**
+ * @brief Compares the column kernels for each instruction set this CPU supports.
+ * 
+ * A block of random readings is flushed over and over, as the parser would
+ * flush it, until the given number of rows has been processed. The block stays
+ * in cache, so this times the kernels rather than memory.
+ * 
+ * @param sensors The number of sensors in each row.
+ * @param rows The number of rows to process with each set of kernels.
+ */
+void benchmarkColumnKernels(int sensors, long rows) {
+    const ColumnKernels *candidates[3];
+    int candidateCount = 0;
+    const ColumnKernels *selected = columnKernels;
+    SensorBlock *block = newSensorBlock();
+    SensorAnalysis analysis;
+    double scalarTime = 0.0;
+
+    candidates[candidateCount++] = &scalarKernels;
+#ifdef HAVE_X86_KERNELS
+    if (__builtin_cpu_supports("sse2")) {
+        candidates[candidateCount++] = &sseKernels;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        candidates[candidateCount++] = &avx2Kernels;
+    }
+#endif
+
+    srand(1);
+    for (int i = 0; i < sensors; i++) {
+        for (int j = 0; j < BLOCK_ROWS; j++) {
+            block->columns[i][j] = rand() / (float)RAND_MAX * 200.0f - 50.0f;
+        }
+    }
+    for (int j = 0; j < BLOCK_ROWS; j++) {
+        snprintf(block->timestamps[j], BUFFER, "%d", j);
+    }
+
+    printf("Column kernels (%d sensors, %ld rows):\n", sensors, rows);
+    for (int k = 0; k < candidateCount; k++) {
+        columnKernels = candidates[k];
+        initSensorAnalysis(&analysis);
+        analysis.expectedSensorCount = sensors;
+
+        double start = currentSeconds();
+        for (long done = 0; done < rows; done += BLOCK_ROWS) {
+            block->rows = BLOCK_ROWS;
+            flushSensorBlock(&analysis, block);
+        }
+        double elapsed = currentSeconds() - start;
+        if (k == 0) {
+            scalarTime = elapsed;
+        }
+        printf("  - %-6s %8.3f s  %8.2f M rows/s  %.2fx\n", candidates[k]->name, elapsed,
+               rows / elapsed / 1e6, scalarTime / elapsed);
+        freeSensorAnalysis(&analysis);
     }
-}
\ No newline at end of file
+    columnKernels = selected;
+    free(block);
+}
@@ -0,0 +1,303 @@
+/**
+ * @file sensorGen.c
+ * @author Dylan Baker
+ *
+ * @brief Sensor Data Generator
+ * This program writes synthetic sensor data files in the format read by
+ * formattedInput.c, for benchmarking and testing the parser. The number of rows
+ * and sensors, the way readings are written, the timestamps and the length of
+ * each line can all be chosen. The same options and seed always give the same file.
+ *
+ * Build with: gcc -O2 -o sensorGen sensorGen.c
+ *
+ * @version 0.1
+ * @date 2024-11-23
+ * @copyright Copyright (c) 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define MAX_SENSORS 100             // Most readings per line that formattedInput.c accepts
+#define BUFFER 64                   // Room for one formatted timestamp or reading
+#define MAX_READING 1e50            // Bound on the size of a reading, so that every format fits in BUFFER
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define START_TIME 1732320000       // 2024-11-23T00:00:00 UTC, the first timestamp
+
+/**
+ * @brief Settings taken from the command line.
+ */
+typedef struct {
+    long rows;                  // Number of lines to write
+    int sensors;                // Readings per line
+    char *format;               // fixed, exp, mixed or int
+    int decimals;               // Digits after the decimal point
+    int width;                  // Least characters per reading, padded with spaces
+    char *timestamps;           // iso, epoch or clock
+    long step;                  // Seconds between lines
+    double minReading;          // Smallest reading
+    double maxReading;          // Largest reading
+    uint64_t seed;              // Seed of the random generator
+} GeneratorOptions;
+
+// Declaration of functions
+int parseGeneratorOptions(int argc, char *argv[], GeneratorOptions *options);
+void printUsage(void);
+uint64_t nextRandom(uint64_t *state);
+double randomReading(uint64_t *state, const GeneratorOptions *options);
+int formatTimestamp(char *dest, long row, const GeneratorOptions *options);
+int formatReading(char *dest, double reading, uint64_t *state, const GeneratorOptions *options);
+void generateSensorData(FILE *outputFile, const GeneratorOptions *options);
+
+/**
+ * @brief main
+ *
+ * Reads the options, then writes the sensor data to the file named after the
+ * options, or to standard output if no file is named.
+ *
+ * @param argc The number of command line arguments passed to the program.
+ * @param argv Array of command line arguments.
+ * @return int Exit status code; 0 indicates success; 1 indictates an error.
+ */
+int main(int argc, char *argv[]) {
+    GeneratorOptions options = { 100000, 5, "fixed", 3, 0, "iso", 1, -50.0, 150.0, 1 };
+    FILE *outputFile = stdout;
+
+    int first = parseGeneratorOptions(argc, argv, &options);
+    if (argc - first > 1) {
+        printUsage();
+        exit(1);
+    }
+    if (argc - first == 1) {
+        outputFile = fopen(argv[first], "w");
+        if (outputFile == NULL) {
+            fprintf(stderr, "Error: Could not open file '%s'. Please check file path.\n", argv[first]);
+            exit(1);
+        }
+    }
+
+    generateSensorData(outputFile, &options);
+
+    if (fclose(outputFile) != 0) {
+        fprintf(stderr, "Warning: Terminating program (could not write sensor data).\n");
+        exit(1);
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads the options given before the output file name.
+ *
+ * The program terminates if an option is unknown, is missing its value, or has
+ * a value out of range.
+ *
+ * @param argc The number of command line arguments passed to the program.
+ * @param argv Array of command line arguments.
+ * @param options The settings to fill in, already holding the defaults.
+ * @return int The index of the first argument that is not an option.
+ */
+int parseGeneratorOptions(int argc, char *argv[], GeneratorOptions *options) {
+    int i = 1;
+
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printUsage();
+            exit(0);
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Warning: Terminating program (missing value after %s).\n", argv[i]);
+            exit(1);
+        }
+
+        if (strcmp(argv[i], "--rows") == 0) {
+            options->rows = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--sensors") == 0) {
+            options->sensors = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0) {
+            options->format = argv[++i];
+        } else if (strcmp(argv[i], "--decimals") == 0) {
+            options->decimals = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--width") == 0) {
+            options->width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--timestamps") == 0) {
+            options->timestamps = argv[++i];
+        } else if (strcmp(argv[i], "--step") == 0) {
+            options->step = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--min") == 0) {
+            options->minReading = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max") == 0) {
+            options->maxReading = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            options->seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Warning: Terminating program (unknown option '%s').\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if (options->rows < 0 || options->sensors < 1 || options->sensors > MAX_SENSORS ||
+        options->decimals < 0 || options->decimals > 9 || options->width < 0 || options->width > BUFFER - 1 ||
+        options->step < 1 || options->minReading > options->maxReading ||
+        !(options->minReading > -MAX_READING && options->maxReading < MAX_READING)) {
+        fprintf(stderr, "Warning: Terminating program (option out of range).\n");
+        exit(1);
+    }
+    if (strcmp(options->format, "fixed") != 0 && strcmp(options->format, "exp") != 0 &&
+        strcmp(options->format, "mixed") != 0 && strcmp(options->format, "int") != 0) {
+        fprintf(stderr, "Warning: Terminating program (unknown format '%s').\n", options->format);
+        exit(1);
+    }
+    if (strcmp(options->timestamps, "iso") != 0 && strcmp(options->timestamps, "epoch") != 0 &&
+        strcmp(options->timestamps, "clock") != 0) {
+        fprintf(stderr, "Warning: Terminating program (unknown timestamps '%s').\n", options->timestamps);
+        exit(1);
+    }
+    return i;
+}
+
+/**
+ * @brief Prints how to run the program.
+ */
+void printUsage(void) {
+    printf("Usage: ./sensorGen [options] [output.txt]\n"
+           "  --rows N          Lines to write (default 100000)\n"
+           "  --sensors N       Readings per line, 1 to %d (default 5)\n"
+           "  --format F        fixed (12.345), exp (1.234e+01), int (12), or mixed,\n"
+           "                    which also adds explicit plus signs (default fixed)\n"
+           "  --decimals D      Digits after the decimal point (default 3)\n"
+           "  --width W         Pad each reading to W characters, to lengthen lines (default 0)\n"
+           "  --timestamps T    iso (2024-11-23T00:00:00), epoch (1732320000) or\n"
+           "                    clock (00:00:00) (default iso)\n"
+           "  --step S          Seconds between lines (default 1)\n"
+           "  --min X --max Y   Range of the readings (default -50 to 150)\n"
+           "  --seed N          Seed of the random readings (default 1)\n", MAX_SENSORS);
+}
+
+/**
+ * @brief Returns the next number from a xorshift64* generator.
+ *
+ * The generator is small and fast, and unlike rand() gives the same sequence
+ * on every platform, so a seed always produces the same file.
+ *
+ * @param state The state of the generator, which must not be 0.
+ * @return uint64_t The next pseudo-random number.
+ */
+uint64_t nextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/**
+ * @brief Draws a reading uniformly from the range in the options.
+ *
+ * @param state The state of the random generator.
+ * @param options The generator settings.
+ * @return double The reading.
+ */
+double randomReading(uint64_t *state, const GeneratorOptions *options) {
+    double unit = (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+
+    return options->minReading + unit * (options->maxReading - options->minReading);
+}
+
+/**
+ * @brief Writes the timestamp of a line.
+ *
+ * @param dest Buffer of BUFFER characters that receives the timestamp.
+ * @param row The number of the line, from 0.
+ * @param options The generator settings.
+ * @return int The number of characters written.
+ */
+int formatTimestamp(char *dest, long row, const GeneratorOptions *options) {
+    time_t seconds = START_TIME + (time_t)row * options->step;
+    struct tm parts;
+
+    if (strcmp(options->timestamps, "epoch") == 0) {
+        return snprintf(dest, BUFFER, "%lld", (long long)seconds);
+    }
+
+    gmtime_r(&seconds, &parts);
+    if (strcmp(options->timestamps, "clock") == 0) {
+        return (int)strftime(dest, BUFFER, "%H:%M:%S", &parts);
+    }
+    return (int)strftime(dest, BUFFER, "%Y-%m-%dT%H:%M:%S", &parts);
+}
+
+/**
+ * @brief Writes one reading in the format chosen in the options.
+ *
+ * @param dest Buffer of BUFFER characters that receives the reading.
+ * @param reading The reading to write.
+ * @param state The state of the random generator, used by the mixed format.
+ * @param options The generator settings.
+ * @return int The number of characters written. The program terminates if the
+ * reading does not fit in BUFFER characters.
+ */
+int formatReading(char *dest, double reading, uint64_t *state, const GeneratorOptions *options) {
+    const char *format = options->format;
+    int width = options->width;
+    int decimals = options->decimals;
+    int length;
+
+    if (strcmp(format, "mixed") == 0) {
+        // Pick a format for each reading, and sometimes write a plus sign
+        static const char *const formats[] = { "%*.*f", "%*.*e", "%+*.*f", "%+*.*E" };
+        uint64_t choice = nextRandom(state);
+
+        if ((choice & 7) == 0) {
+            length = snprintf(dest, BUFFER, "%*.0f", width, reading);
+        } else {
+            length = snprintf(dest, BUFFER, formats[(choice >> 3) & 3], width, decimals, reading);
+        }
+    } else if (strcmp(format, "exp") == 0) {
+        length = snprintf(dest, BUFFER, "%*.*e", width, decimals, reading);
+    } else if (strcmp(format, "int") == 0) {
+        length = snprintf(dest, BUFFER, "%*.0f", width, reading);
+    } else {
+        length = snprintf(dest, BUFFER, "%*.*f", width, decimals, reading);
+    }
+
+    // A truncated reading would leave length past the end of what was written
+    if (length < 0 || length >= BUFFER) {
+        fprintf(stderr, "Warning: Terminating program (reading too long to write).\n");
+        exit(1);
+    }
+    return length;
+}
+
+/**
+ * @brief Writes every line of sensor data.
+ *
+ * Each line holds a timestamp followed by one reading per sensor, separated by
+ * single spaces, and ends with a newline.
+ *
+ * @param outputFile The file where the sensor data is written.
+ * @param options The generator settings.
+ */
+void generateSensorData(FILE *outputFile, const GeneratorOptions *options) {
+    uint64_t state = options->seed ? options->seed : 1;
+    char *line = malloc((size_t)(options->sensors + 1) * BUFFER + 1);
+
+    if (line == NULL) {
+        fprintf(stderr, "Warning: Terminating program (out of memory).\n");
+        exit(1);
+    }
+    setvbuf(outputFile, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    for (long row = 0; row < options->rows; row++) {
+        int length = formatTimestamp(line, row, options);
+
+        for (int i = 0; i < options->sensors; i++) {
+            line[length++] = ' ';
+            length += formatReading(line + length, randomReading(&state, options), &state, options);
+        }
+        line[length++] = '\n';
+        fwrite(line, 1, length, outputFile);
+    }
+    free(line);
+}